@@ -0,0 +1,74 @@
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "audio_mix.h"
+
+// mixes 256-frame callback buffers into stereo output, with the vectorized kernels and with a plain
+// per-sample loop, and reports how many voices fit in the time one buffer lasts at 48kHz
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr uint32_t BUFFER_FRAMES = 256;
+static constexpr double SAMPLE_RATE = 48000.0;
+static constexpr uint32_t SOUND_FRAMES = 48000;
+static constexpr int VOICES = 64;
+static constexpr int BUFFERS = 2000;
+
+// what the stream callback did before the kernels, kept here as the baseline
+static void mixFramesScalar(float* output, uint32_t outputChannels, const float* source, uint32_t sourceChannels, uint32_t numFrames, float gain)
+{
+    for (uint32_t i = 0; i < numFrames; ++i)
+    {
+        for (uint32_t j = 0; j < outputChannels; ++j)
+        {
+            output[i * outputChannels + j] += gain * source[i * sourceChannels + (j < sourceChannels ? j : sourceChannels - 1)];
+        }
+    }
+}
+
+template <typename Mix>
+static double microsecondsPerVoice(Mix mix, const std::vector<float>& sound, uint32_t sourceChannels, std::vector<float>& output)
+{
+    auto start = Clock::now();
+    for (int buffer = 0; buffer < BUFFERS; ++buffer)
+    {
+        std::fill(output.begin(), output.end(), 0.0f);
+        // voices start at different points in the sound, as they would in play
+        for (int voice = 0; voice < VOICES; ++voice)
+        {
+            uint32_t cursor = (buffer * BUFFER_FRAMES + voice * 997) % (SOUND_FRAMES - BUFFER_FRAMES);
+            mix(output.data(), 2, sound.data() + cursor * sourceChannels, sourceChannels, BUFFER_FRAMES, 0.25f);
+        }
+    }
+    double total = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    return total / (static_cast<double>(BUFFERS) * VOICES);
+}
+
+int main()
+{
+    double budget = BUFFER_FRAMES / SAMPLE_RATE * 1e6;
+    std::printf("%u frame buffer: %.1f us budget\n", BUFFER_FRAMES, budget);
+
+    std::vector<float> output(BUFFER_FRAMES * 2);
+    float checksum = 0;
+    for (uint32_t sourceChannels = 1; sourceChannels <= 2; ++sourceChannels)
+    {
+        std::vector<float> sound(SOUND_FRAMES * sourceChannels);
+        for (size_t i = 0; i < sound.size(); ++i)
+        {
+            sound[i] = static_cast<float>(i % 200) / 100.0f - 1.0f;
+        }
+
+        double scalar = microsecondsPerVoice(mixFramesScalar, sound, sourceChannels, output);
+        checksum += output[BUFFER_FRAMES];
+        double kernel = microsecondsPerVoice(mixFrames, sound, sourceChannels, output);
+        checksum += output[BUFFER_FRAMES];
+
+        const char* layout = sourceChannels == 1 ? "mono->stereo" : "stereo->stereo";
+        std::printf("%-15s scalar %.3f us/voice (%.0f voices), kernel %.3f us/voice (%.0f voices)\n",
+            layout, scalar, budget / scalar, kernel, budget / kernel);
+    }
+    std::printf("checksum %f\n", checksum);
+}
@@ -0,0 +1,73 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "audio_queue.h"
+
+// pushes a long numbered sequence of commands through one queue from a producer thread while the main thread
+// pops them, and checks that every command arrives once, in order and intact. the queue is far smaller than the
+// sequence, so the full and empty cases are hit constantly. a build with -Db_sanitize=thread also checks that
+// each command is published before it is read. returns non-zero on failure
+
+#define COMMAND_COUNT (1u << 17)
+
+static AudioQueue queue;
+
+static void* produce(void* arg)
+{
+    (void)arg;
+    for (uint32_t i = 0; i < COMMAND_COUNT; ++i)
+    {
+        AudioCommand command = { 0 };
+        command.type = (AudioCommandType)(i % (AUDIO_COMMAND_FINISHED + 1));
+        command.sound = (Sound*)(uintptr_t)(i + 1);
+        command.value = (float)(i & 0xffff);
+        command.stream = (SoundStream*)(uintptr_t)~i;
+        while (!audioQueuePush(&queue, &command))
+        {
+        }
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    audioQueueInit(&queue);
+    pthread_t producer;
+    if (pthread_create(&producer, NULL, produce, NULL) != 0)
+    {
+        printf("FAIL couldn't start the producer thread\n");
+        return 1;
+    }
+
+    int failed = 0;
+    for (uint32_t i = 0; i < COMMAND_COUNT && !failed; ++i)
+    {
+        AudioCommand command;
+        while (!audioQueuePop(&queue, &command))
+        {
+        }
+        if (command.type != (AudioCommandType)(i % (AUDIO_COMMAND_FINISHED + 1)) || command.sound != (Sound*)(uintptr_t)(i + 1)
+            || command.value != (float)(i & 0xffff) || command.stream != (SoundStream*)(uintptr_t)~i)
+        {
+            printf("FAIL command %u arrived as sound %p, value %g\n", i, (void*)command.sound, command.value);
+            failed = 1;
+        }
+    }
+
+    if (failed)
+    {
+        // the producer may be stuck on a full queue, so don't wait for it
+        return 1;
+    }
+    pthread_join(producer, NULL);
+
+    AudioCommand command;
+    if (audioQueuePop(&queue, &command))
+    {
+        printf("FAIL the queue holds more commands than were pushed\n");
+        return 1;
+    }
+    printf("%u commands passed through in order\n", COMMAND_COUNT);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <vector>
+
+#include "image_loader.hpp"
+
+// decodes the game's startup images one after another, then all at once on an ImageLoader.
+// run from the repository root so the texture paths resolve
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static const char* const filenames[] = {
+    "textures/character.png",
+    "textures/arm.png",
+    "textures/house.png",
+    "textures/depot.png",
+    "textures/arrow.png",
+    "textures/close_button.png",
+    "textures/font.png",
+    "textures/intersection.png",
+    "textures/road_horizontal.png",
+    "textures/road_vertical.png",
+};
+
+static size_t checksum(const Image& image)
+{
+    return image.pixels.size() + image.width + image.height;
+}
+
+int main()
+{
+    constexpr int runs = 20;
+
+    size_t sequentialSum = 0;
+    auto start = Clock::now();
+    for (int run = 0; run < runs; ++run)
+    {
+        for (auto filename : filenames)
+        {
+            sequentialSum += checksum(loadImage(filename));
+        }
+    }
+    double sequentialTime = millisecondsSince(start) / runs;
+
+    // the loader's threads are started once, like the game does at startup, so that cost is included
+    size_t parallelSum = 0;
+    start = Clock::now();
+    for (int run = 0; run < runs; ++run)
+    {
+        ImageLoader loader;
+        std::vector<uint32_t> tickets;
+        for (auto filename : filenames)
+        {
+            tickets.push_back(loader.request(filename));
+        }
+        for (auto ticket : tickets)
+        {
+            parallelSum += checksum(loader.wait(ticket));
+        }
+    }
+    double parallelTime = millisecondsSince(start) / runs;
+
+    if (sequentialSum != parallelSum)
+    {
+        std::printf("decoded images differ\n");
+        return 1;
+    }
+    std::printf("%zu images: %8.3f ms sequential, %8.3f ms on an ImageLoader\n", std::size(filenames), sequentialTime, parallelTime);
+    return 0;
+}
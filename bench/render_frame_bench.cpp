@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "ecs.hpp"
+#include "render_backend.hpp"
+#include "renderer.hpp"
+#include "scene_graph.hpp"
+#include "tilemap.hpp"
+
+// runs the whole CPU side of a frame (culling, sorting, batching, instance writes, command building)
+// against the null backend. a few percent of the sprites move every frame, like the game's characters
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void runBenchmark(uint32_t spriteCount, int frames)
+{
+    std::mt19937 random(spriteCount);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_int_distribution<uint32_t> texture(1, 4);
+
+    SceneGraph sceneGraph;
+    DrawInstanceManager drawInstances;
+    ComponentManager<TextInstance> textInstances;
+    ComponentManager<Tilemap> tilemaps;
+    for (uint32_t index = 1; index <= spriteCount; ++index)
+    {
+        sceneGraph.create(index);
+        sceneGraph.setPosition(index, { position(random), position(random) });
+        drawInstances.create(index);
+        auto& instance = drawInstances.get(index);
+        instance.texture = texture(random);
+        instance.isStatic = index % 2 == 0;
+    }
+    for (uint32_t index = spriteCount + 1; index <= spriteCount + 20; ++index)
+    {
+        sceneGraph.create(index);
+        sceneGraph.setPosition(index, { -4.5f, 4.0f - 0.5f * (index - spriteCount) });
+        drawInstances.create(index);
+        drawInstances.get(index).isText = true;
+        drawInstances.get(index).layer = 1;
+        textInstances.create(index);
+        textInstances.get(index).text = "DELIVERIES: 12";
+    }
+
+    NullRenderBackend backend;
+    Renderer renderer(backend, sceneGraph, drawInstances, textInstances, tilemaps);
+    std::vector<glm::mat4> cameras = {
+        glm::ortho(-60.0f, 60.0f, -34.0f, 34.0f),
+        glm::ortho(-8.0f, 8.0f, -5.0f, 5.0f),
+    };
+
+    std::uniform_int_distribution<uint32_t> movingIndex(0, spriteCount / 2 - 1);
+    std::uniform_real_distribution<float> step(-0.1f, 0.1f);
+    double frameTime = 0;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        for (uint32_t i = 0; i < spriteCount / 50; ++i)
+        {
+            uint32_t index = 2 * movingIndex(random) + 1;
+            sceneGraph.setPosition(index, sceneGraph.getLocalTransform(index).position + glm::vec2(step(random), step(random)));
+        }
+
+        auto start = Clock::now();
+        renderer.prepareRender(cameras, frame / 60.0f);
+        renderer.render(1280, 720, glm::vec4(0.0f));
+        frameTime += millisecondsSince(start);
+    }
+
+    std::printf("%8u sprites: %8.3f ms/frame, %6.1f draws/frame, %9.1f instances/frame, %5zu commands in last frame\n", spriteCount,
+        frameTime / frames, static_cast<double>(backend.getCommandCount(RenderCommandType::DrawInstances)) / frames,
+        static_cast<double>(backend.getDrawnInstances()) / frames, backend.getRecordedCommands().size());
+}
+
+int main()
+{
+    for (uint32_t spriteCount : { 10000, 50000, 200000 })
+    {
+        runBenchmark(spriteCount, 60);
+    }
+    return 0;
+}
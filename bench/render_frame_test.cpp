@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "ecs.hpp"
+#include "render_backend.hpp"
+#include "renderer.hpp"
+#include "scene_graph.hpp"
+#include "tilemap.hpp"
+
+// renders a fixed scene through the null backend and checks what the renderer produced: batches, draws,
+// state changes, the instance ranges each draw reads, and how many instances were culled. returns non-zero on failure
+
+static int failures = 0;
+
+static void expect(const char* what, uint64_t actual, uint64_t expected)
+{
+    if (actual != expected)
+    {
+        std::printf("FAIL %s: got %llu, expected %llu\n", what, static_cast<unsigned long long>(actual), static_cast<unsigned long long>(expected));
+        ++failures;
+    }
+}
+
+struct ExpectedDraw
+{
+    InstanceStream stream;
+    uint32_t first;
+    uint32_t instanceCount;
+};
+
+static void expectDraws(const char* frame, const NullRenderBackend& backend, const std::vector<ExpectedDraw>& expected)
+{
+    std::vector<RenderCommand> draws;
+    for (const auto& command : backend.getRecordedCommands())
+    {
+        if (command.type == RenderCommandType::DrawInstances)
+        {
+            draws.push_back(command);
+        }
+    }
+    expect(frame, draws.size(), expected.size());
+    for (uint32_t i = 0; i < draws.size() && i < expected.size(); ++i)
+    {
+        expect(frame, static_cast<uint64_t>(draws[i].stream), static_cast<uint64_t>(expected[i].stream));
+        expect(frame, draws[i].first, expected[i].first);
+        expect(frame, draws[i].instanceCount, expected[i].instanceCount);
+    }
+}
+
+static void createSprite(SceneGraph& sceneGraph, DrawInstanceManager& drawInstances, uint32_t index, glm::vec2 position, GLuint texture)
+{
+    sceneGraph.create(index);
+    sceneGraph.setPosition(index, position);
+    drawInstances.create(index);
+    drawInstances.get(index).texture = texture;
+}
+
+int main()
+{
+    SceneGraph sceneGraph;
+    DrawInstanceManager drawInstances;
+    ComponentManager<TextInstance> textInstances;
+    ComponentManager<Tilemap> tilemaps;
+
+    // layer 0 sprites share a row so that depth doesn't split their batches
+    createSprite(sceneGraph, drawInstances, 1, { -6.0f, 0.0f }, 10);
+    createSprite(sceneGraph, drawInstances, 2, { -3.0f, 0.0f }, 10);
+    createSprite(sceneGraph, drawInstances, 3, { 0.0f, 0.0f }, 11);
+    createSprite(sceneGraph, drawInstances, 4, { 3.0f, 0.0f }, 10);
+    createSprite(sceneGraph, drawInstances, 5, { 100.0f, 0.0f }, 10); // off screen
+    createSprite(sceneGraph, drawInstances, 6, { 6.0f, 0.0f }, 10);
+    drawInstances.get(6).isStatic = true;
+    createSprite(sceneGraph, drawInstances, 7, { 50.0f, 50.0f }, 10); // static and off screen
+    drawInstances.get(7).isStatic = true;
+    createSprite(sceneGraph, drawInstances, 8, { -5.0f, -5.0f }, 12);
+    drawInstances.get(8).isBaked = true;
+    createSprite(sceneGraph, drawInstances, 9, { 5.0f, -5.0f }, 12);
+    drawInstances.get(9).isBaked = true;
+
+    sceneGraph.create(10);
+    sceneGraph.setPosition(10, { -4.0f, 4.0f });
+    drawInstances.create(10);
+    drawInstances.get(10).isText = true;
+    drawInstances.get(10).layer = 1;
+    textInstances.create(10);
+    textInstances.get(10).text = "HI 5";
+
+    // there are only cameras for layers 0 and 1
+    createSprite(sceneGraph, drawInstances, 12, { 0.0f, 0.0f }, 10);
+    drawInstances.get(12).layer = 2;
+
+    tilemaps.create(11);
+    auto& tilemap = tilemaps.get(11);
+    tilemap.width = 4;
+    tilemap.height = 4;
+    tilemap.tiles.assign(16, 1);
+    tilemap.tileset = 20;
+
+    NullRenderBackend backend;
+    Renderer renderer(backend, sceneGraph, drawInstances, textInstances, tilemaps);
+    std::vector<glm::mat4> cameras = {
+        glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f),
+        glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f),
+    };
+
+    // tilemap, then the baked batch, then textures 10 and 11 on layer 0, then the text on layer 1
+    renderer.prepareRender(cameras, 0.0f);
+    renderer.render(1280, 720, glm::vec4(0.0f));
+    const auto& stats = renderer.getStats();
+    expect("first frame visible instances", stats.visibleInstances, 6);
+    expect("first frame culled instances", stats.culledInstances, 3);
+    expect("first frame batches", stats.batches, 5);
+    expect("first frame draw calls", stats.drawCalls, 5);
+    expect("first frame instances", stats.instances, 10);
+    expect("first frame state changes", stats.stateChanges, 10);
+    expect("first frame program changes", backend.getCommandCount(RenderCommandType::UseProgram), 3);
+    expect("first frame texture binds", backend.getCommandCount(RenderCommandType::BindTexture), 5);
+    expect("first frame static uploads", backend.getCommandCount(RenderCommandType::UploadStaticInstances), 1);
+    expect("first frame tilemap uploads", backend.getCommandCount(RenderCommandType::UploadTilemap), 1);
+    expect("first frame tilemap draws", backend.getCommandCount(RenderCommandType::DrawTilemap), 1);
+    expect("first frame instance records", backend.getFrameInstances().size(), 5);
+    expect("first frame glyph records", backend.getFrameGlyphs().size(), 3);
+    expectDraws("first frame draws", backend, {
+        { InstanceStream::Static, 0, 2 },
+        { InstanceStream::Frame, 0, 4 },
+        { InstanceStream::Frame, 4, 1 },
+        { InstanceStream::Glyph, 0, 3 },
+    });
+
+    // nothing is uploaded again, and the sprite that moved into view joins the texture 10 batch
+    backend.resetCounts();
+    sceneGraph.setPosition(5, { 8.0f, 0.0f });
+    renderer.prepareRender(cameras, 1.0f);
+    renderer.render(1280, 720, glm::vec4(0.0f));
+    expect("second frame visible instances", stats.visibleInstances, 7);
+    expect("second frame culled instances", stats.culledInstances, 2);
+    expect("second frame batches", stats.batches, 5);
+    expect("second frame draw calls", stats.drawCalls, 5);
+    expect("second frame static uploads", backend.getCommandCount(RenderCommandType::UploadStaticInstances), 0);
+    expect("second frame tilemap uploads", backend.getCommandCount(RenderCommandType::UploadTilemap), 0);
+    expectDraws("second frame draws", backend, {
+        { InstanceStream::Static, 0, 2 },
+        { InstanceStream::Frame, 0, 5 },
+        { InstanceStream::Frame, 5, 1 },
+        { InstanceStream::Glyph, 0, 3 },
+    });
+
+    // destroying a baked instance moves the static generation, so the rest are baked and uploaded again
+    backend.resetCounts();
+    drawInstances.destroy(9);
+    renderer.prepareRender(cameras, 2.0f);
+    renderer.render(1280, 720, glm::vec4(0.0f));
+    expect("third frame static uploads", backend.getCommandCount(RenderCommandType::UploadStaticInstances), 1);
+    expect("third frame instances", stats.instances, 10);
+    expectDraws("third frame draws", backend, {
+        { InstanceStream::Static, 0, 1 },
+        { InstanceStream::Frame, 0, 5 },
+        { InstanceStream::Frame, 5, 1 },
+        { InstanceStream::Glyph, 0, 3 },
+    });
+
+    if (failures > 0)
+    {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "ecs.hpp"
+#include "render_sort.hpp"
+#include "renderer.hpp"
+#include "scene_graph.hpp"
+
+// CPU-only comparison of the old comparator sort against packed keys + radix sort.
+// mirrors the layout the game produces: most sprites on layer 0, a handful of textures
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void runBenchmark(uint32_t spriteCount, int iterations)
+{
+    std::mt19937 random(spriteCount);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_int_distribution<uint32_t> texture(1, 9);
+    std::uniform_int_distribution<uint32_t> layer(0, 15);
+
+    SceneGraph sceneGraph;
+    DrawInstanceManager drawInstances;
+    for (uint32_t index = 1; index <= spriteCount; ++index)
+    {
+        sceneGraph.create(index);
+        sceneGraph.setPosition(index, { position(random), position(random) });
+        drawInstances.create(index);
+        auto& instance = drawInstances.get(index);
+        instance.texture = texture(random);
+        instance.layer = layer(random) == 0 ? 1 : 0;
+    }
+
+    std::vector<uint32_t> sortIndices;
+    double comparatorTime = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto start = Clock::now();
+        sortIndices.assign(drawInstances.indices().begin(), drawInstances.indices().end());
+        std::sort(sortIndices.begin(), sortIndices.end(),
+            [&] (auto index0, auto index1)
+            {
+                const auto& instance0 = drawInstances.get(index0);
+                const auto& instance1 = drawInstances.get(index1);
+                return (instance0.layer == instance1.layer && sceneGraph.getWorldTransform(index0).depth < sceneGraph.getWorldTransform(index1).depth) || instance0.layer < instance1.layer;
+            });
+        comparatorTime += millisecondsSince(start);
+    }
+
+    std::vector<SortEntry> entries;
+    std::vector<SortEntry> scratch;
+    double radixTime = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto start = Clock::now();
+        entries.clear();
+        for (auto index : drawInstances.indices())
+        {
+            const auto& instance = drawInstances.get(index);
+            entries.push_back({ makeSortKey(instance.layer, sceneGraph.getWorldTransform(index).depth, 0, instance.texture), index });
+        }
+        radixSort(entries, scratch);
+        sortIndices.resize(entries.size());
+        for (uint32_t j = 0; j < entries.size(); ++j)
+        {
+            sortIndices[j] = entries[j].index;
+        }
+        radixTime += millisecondsSince(start);
+    }
+
+    for (uint32_t j = 1; j < entries.size(); ++j)
+    {
+        if (entries[j - 1].key > entries[j].key)
+        {
+            std::fprintf(stderr, "radix sort produced out of order keys at %u\n", j);
+            return;
+        }
+    }
+
+    // next frame: a few percent of the sprites (the moving zombies) shift depth slightly
+    std::uniform_int_distribution<uint32_t> entryIndex(0, spriteCount - 1);
+    std::uniform_real_distribution<float> step(-0.1f, 0.1f);
+    std::vector<SortEntry> sorted = entries;
+    double repairTime = 0;
+    double fullTime = 0;
+    uint32_t repaired = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        std::vector<SortEntry> moved = sorted;
+        for (uint32_t j = 0; j < spriteCount / 50; ++j)
+        {
+            auto& entry = moved[entryIndex(random)];
+            uint32_t index = entry.index;
+            const auto& instance = drawInstances.get(index);
+            entry.key = makeSortKey(instance.layer, sceneGraph.getWorldTransform(index).depth + step(random), 0, instance.texture);
+        }
+
+        entries = moved;
+        auto start = Clock::now();
+        if (repairSort(entries, entries.size(), scratch) != SortPath::Full)
+        {
+            ++repaired;
+        }
+        repairTime += millisecondsSince(start);
+
+        entries = moved;
+        start = Clock::now();
+        radixSort(entries, scratch);
+        fullTime += millisecondsSince(start);
+    }
+
+    std::printf("%8u sprites: comparator %8.3f ms, radix %8.3f ms, speedup %5.2fx | coherent frame: repair %7.3f ms (%u/%d repaired), full %7.3f ms\n", spriteCount,
+        comparatorTime / iterations, radixTime / iterations, comparatorTime / radixTime,
+        repairTime / iterations, repaired, iterations, fullTime / iterations);
+}
+
+int main()
+{
+    for (uint32_t spriteCount : { 10000, 25000, 50000, 100000, 200000 })
+    {
+        runBenchmark(spriteCount, 20);
+    }
+    return 0;
+}
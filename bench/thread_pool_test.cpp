@@ -0,0 +1,56 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+// runs many back to back parallelFor loops of varying sizes and checks that every index is visited exactly once,
+// by chunks no larger than asked for. the per-index counters are plain integers, so a build with
+// -Db_sanitize=thread also reports chunks that overlap. returns non-zero on failure
+
+static constexpr uint32_t THREAD_COUNT = 4;
+static constexpr uint32_t ITERATIONS = 2000;
+
+int main()
+{
+    ThreadPool threadPool(THREAD_COUNT);
+    std::vector<uint32_t> visits;
+    int failures = 0;
+    for (uint32_t iteration = 0; iteration < ITERATIONS && failures == 0; ++iteration)
+    {
+        // sizes around the chunk size exercise the single chunk path and partial last chunks
+        uint32_t chunkSize = 1 + iteration % 64;
+        uint32_t count = (iteration * 7919) % 4096;
+        visits.assign(count, 0);
+
+        threadPool.parallelFor(count, chunkSize, [&](uint32_t begin, uint32_t end)
+        {
+            if (end > count || begin >= end || end - begin > chunkSize)
+            {
+                std::printf("FAIL iteration %u: chunk [%u, %u) for count %u and chunk size %u\n", iteration, begin, end, count, chunkSize);
+                std::abort();
+            }
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                ++visits[i];
+            }
+        });
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (visits[i] != 1)
+            {
+                std::printf("FAIL iteration %u: index %u of %u visited %u times\n", iteration, i, count, visits[i]);
+                ++failures;
+                break;
+            }
+        }
+    }
+
+    if (failures > 0)
+    {
+        return 1;
+    }
+    std::printf("%u loops on %u threads passed\n", ITERATIONS, threadPool.getThreadCount());
+    return 0;
+}
@@ -1,28 +1,30 @@
 #version 330
 
 in vec2 v_texCoord;
-flat in int instanceID;
+in vec4 v_color;
 
 layout(location = 0) out vec4 fragmentColor;
 
-uniform sampler2D textureSampler;
+#ifdef TEXTURE_ARRAY
+flat in int v_textureLayer;
 
-struct Material
-{
-    vec4 color;
-    int useTexture;
-};
+uniform sampler2DArray textureSampler;
+#else
+uniform sampler2D textureSampler;
+#endif
 
-layout(std140) uniform MaterialData
-{
-    Material materials[256];
-};
+// set per draw, from whether the batch has a texture
+uniform bool useTexture;
 
 void main()
 {
-    fragmentColor = materials[instanceID].color;
-    if (materials[instanceID].useTexture != 0)
+    fragmentColor = v_color;
+    if (useTexture)
     {
+#ifdef TEXTURE_ARRAY
+        fragmentColor *= texture(textureSampler, vec3(v_texCoord, v_textureLayer));
+#else
         fragmentColor *= texture(textureSampler, v_texCoord);
+#endif
     }
 }
@@ -1,19 +1,28 @@
 #version 330
 
-layout(location = 0) in vec2 position;
-layout(location = 1) in vec2 texCoord;
+const vec2[4] corners = vec2[4](vec2(0, 0), vec2(1, 0), vec2(0, 1), vec2(1, 1));
+
+// the font is a 16x8 grid of glyph cells, column-major by character code
+const vec2 glyphScale = vec2(1.0 / 16.0, 1.0 / 8.0);
+
+// already in clip space, see GlyphData
+layout(location = 2) in vec2 origin;
+layout(location = 3) in vec2 xAxis;
+layout(location = 4) in vec2 yAxis;
+layout(location = 5) in vec4 color;
+layout(location = 6) in uint glyph; // column << 8 | character code
 
 out vec2 v_texCoord;
-flat out int instanceID;
+out vec4 v_color;
 
-layout(std140) uniform TransformData
-{
-    mat4 transforms[256];
-};
+uniform vec4 fontRect;
 
 void main()
 {
-    gl_Position = transforms[gl_InstanceID] * vec4(position, 0, 1);
-    v_texCoord = texCoord;
-    instanceID = gl_InstanceID;
+    vec2 corner = corners[gl_VertexID];
+    int character = int(glyph & 0xffu);
+    gl_Position = vec4(origin + (float(glyph >> 8) + corner.x) * xAxis + corner.y * yAxis, 0, 1);
+    vec2 glyphCoord = glyphScale * (vec2(character >> 3, character & 7) + vec2(corner.x, 1.0 - corner.y));
+    v_texCoord = fontRect.xy + fontRect.zw * glyphCoord;
+    v_color = color;
 }
@@ -0,0 +1,22 @@
+#version 330
+
+in vec2 v_cell;
+
+layout(location = 0) out vec4 fragmentColor;
+
+uniform sampler2DArray tileset;
+uniform usampler2D tileMap;
+uniform vec4 color;
+
+void main()
+{
+    uint tile = texelFetch(tileMap, ivec2(v_cell), 0).r;
+    if (tile == 0u)
+    {
+        discard;
+    }
+
+    // tiles are stored top row first. gradients come from the unwrapped cell position so mip selection doesn't jump at tile edges
+    vec2 tileCoord = fract(v_cell);
+    fragmentColor = color * textureGrad(tileset, vec3(tileCoord.x, 1.0 - tileCoord.y, float(tile - 1u)), dFdx(v_cell), dFdy(v_cell));
+}
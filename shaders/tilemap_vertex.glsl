@@ -0,0 +1,16 @@
+#version 330
+
+const vec2[4] corners = vec2[4](vec2(0, 0), vec2(1, 0), vec2(0, 1), vec2(1, 1));
+
+uniform mat4 viewProjection;
+uniform vec2 origin;
+uniform float tileSize;
+uniform vec2 mapSize;
+
+out vec2 v_cell;
+
+void main()
+{
+    v_cell = corners[gl_VertexID] * mapSize;
+    gl_Position = viewProjection * vec4(origin + tileSize * v_cell, 0, 1);
+}
@@ -2,17 +2,31 @@
 
 const vec2[4] corners = vec2[4](vec2(0, 0), vec2(1, 0), vec2(0, 1), vec2(1, 1));
 
+layout(location = 2) in mat4 transform;
+layout(location = 6) in vec4 color;
+layout(location = 7) in vec4 texRect;
+layout(location = 8) in int textureLayer;
+layout(location = 9) in float animationStart;
+layout(location = 10) in uint animation; // frames per second in 1/256ths, frame count, loop. see InstanceData
+
 out vec2 v_texCoord;
-flat out int instanceID;
+out vec4 v_color;
+flat out int v_textureLayer;
 
-layout(std140) uniform TransformData
-{
-    mat4 transforms[256];
-};
+// identity unless drawing baked instances, which are stored in world space
+uniform mat4 viewProjection;
+uniform float time;
 
 void main()
 {
-    gl_Position = transforms[gl_InstanceID] * vec4(corners[gl_VertexID] - 0.5, 0, 1);
-    v_texCoord = vec2(corners[gl_VertexID].x, 1.0 - corners[gl_VertexID].y);
-    instanceID = gl_InstanceID;
+    gl_Position = viewProjection * transform * vec4(corners[gl_VertexID] - 0.5, 0, 1);
+    // frames split texRect horizontally. non-looping animations hold their last frame
+    float framesPerSecond = float(animation & 0xffffu) / 256.0;
+    float frameCount = float(max((animation >> 16) & 0x7fffu, 1u));
+    float frame = floor(max(time - animationStart, 0.0) * framesPerSecond);
+    frame = (animation >> 31) != 0u ? mod(frame, frameCount) : min(frame, frameCount - 1.0);
+    vec2 frameScale = vec2(texRect.z / frameCount, texRect.w);
+    v_texCoord = texRect.xy + frameScale * vec2(frame + corners[gl_VertexID].x, 1.0 - corners[gl_VertexID].y);
+    v_color = color;
+    v_textureLayer = textureLayer;
 }
@@ -1,6 +1,8 @@
 #include "audio.h"
 
 #include <math.h>
+#include <stdalign.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,81 +11,218 @@
 #include <portaudio.h>
 #include <vorbis/vorbisfile.h>
 
+#include "audio_mix.h"
+#include "audio_queue.h"
+#include "audio_stream.h"
+
+// voices are claimed by play commands, so at most this many are in flight: queued, playing, or finished and not
+// yet seen by audioUpdate. this keeps the finished queue from ever filling up and a play from finding no free voice
+#define MAX_VOICES 64
+
+// sample data is shared by every voice playing the sound and never written after loading
 struct Sound
 {
     float* samples;
     uint32_t numFrames;
     uint32_t numChannels;
     bool loop;
-    bool finished;
+    atomic_uint refCount;
 };
 
-typedef struct PlayingSoundsBuffer
+// one playback of a sound, with its own position, or of a stream, which keeps its own
+typedef struct Voice
 {
-    Sound* sounds[256];
-    uint32_t numSounds;
-} PlayingSoundsBuffer;
+    const Sound* sound;
+    SoundStream* stream;
+    uint32_t cursor; // next frame to mix
+    float gain;
+    bool loop;
+    bool active;
+} Voice;
 
 struct Audio
 {
     PaStream* stream;
     uint32_t numChannels;
-    bool dirty;
-    struct PlayingSoundsBuffer buffers[3];
-    int playing;
-    int lastPlaying;
-    int editing;
+    AudioQueue commands; // game thread to callback
+    AudioQueue finished; // callback to game thread
+    uint32_t numInFlight; // game thread only
+    // callback only
+    Voice voices[MAX_VOICES];
+    float volume;
 };
 
 Audio* newAudio(void)
 {
-    return malloc(sizeof(Audio));
+    // the queues keep their indices on separate cache lines, which needs the struct's alignment
+#ifdef _WIN32
+    return _aligned_malloc(sizeof(Audio), alignof(Audio));
+#else
+    return aligned_alloc(alignof(Audio), sizeof(Audio));
+#endif
 }
 
 void freeAudio(Audio* audio)
 {
+#ifdef _WIN32
+    _aligned_free(audio);
+#else
     free(audio);
+#endif
 }
 
-struct PlayingSoundsBuffer* volatile currentBuffer = NULL;
-
-static uint32_t currentFrame = 0;
-
-static int streamCallback(const void* inputBuffer, void* outputBuffer, unsigned long framesPerBuffer, const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void* userData)
+// the game thread counts the voice as free again once it sees this in audioUpdate
+static void finishVoice(Audio* audio, Voice* voice)
 {
-    Audio* audio = userData;
-
-    PlayingSoundsBuffer* soundBuffer = currentBuffer;
-    memset(outputBuffer, 0, sizeof(float) * audio->numChannels * framesPerBuffer);
+    AudioCommand command = { AUDIO_COMMAND_FINISHED, (Sound*)voice->sound, 0.0f, voice->stream };
+    audioQueuePush(&audio->finished, &command);
+    voice->active = false;
+    voice->sound = NULL;
+    voice->stream = NULL;
+}
 
-    for (uint32_t soundIndex = 0; soundIndex < soundBuffer->numSounds; ++soundIndex)
+static Voice* claimVoice(Audio* audio)
+{
+    for (uint32_t i = 0; i < MAX_VOICES; ++i)
     {
-        Sound* sound = soundBuffer->sounds[soundIndex];
-        if (!sound || sound->finished || sound->numFrames == 0)
+        if (!audio->voices[i].active)
         {
-            return paContinue;
+            audio->voices[i].active = true;
+            return &audio->voices[i];
         }
+    }
+    return NULL;
+}
 
-        for (uint32_t i = 0; i < framesPerBuffer; ++i, ++currentFrame)
+static void processCommands(Audio* audio)
+{
+    AudioCommand command;
+    Voice* voice;
+    while (audioQueuePop(&audio->commands, &command))
+    {
+        switch (command.type)
         {
-            if (currentFrame >= sound->numFrames)
+        case AUDIO_COMMAND_PLAY:
+            if ((voice = claimVoice(audio)))
             {
-                if (sound->loop)
-                {
-                    currentFrame = 0;
-                }
-                else
+                voice->sound = command.sound;
+                voice->cursor = 0;
+                voice->gain = command.value;
+                voice->loop = command.sound->loop;
+            }
+            else
+            {
+                // can't happen while numInFlight holds, but the play still has to be handed back
+                command.type = AUDIO_COMMAND_FINISHED;
+                audioQueuePush(&audio->finished, &command);
+            }
+            break;
+        case AUDIO_COMMAND_PLAY_STREAM:
+            if ((voice = claimVoice(audio)))
+            {
+                voice->stream = command.stream;
+                voice->gain = command.value;
+            }
+            else
+            {
+                command.type = AUDIO_COMMAND_FINISHED;
+                audioQueuePush(&audio->finished, &command);
+            }
+            break;
+        case AUDIO_COMMAND_STOP_ALL:
+            for (uint32_t i = 0; i < MAX_VOICES; ++i)
+            {
+                if (audio->voices[i].active)
                 {
-                    sound->finished = true;
-                    break;
+                    finishVoice(audio, &audio->voices[i]);
                 }
             }
+            break;
+        case AUDIO_COMMAND_SET_VOLUME:
+            audio->volume = command.value;
+            break;
+        default:
+            break;
+        }
+    }
+}
 
-            for (uint32_t j = 0; j < audio->numChannels; ++j)
+static void mixVoice(Audio* audio, Voice* voice, float* output, uint32_t numFrames)
+{
+    // mixed in contiguous runs, split only where a loop wraps around
+    const Sound* sound = voice->sound;
+    float gain = audio->volume * voice->gain;
+    uint32_t mixedFrames = 0;
+    while (mixedFrames < numFrames)
+    {
+        if (voice->cursor >= sound->numFrames)
+        {
+            if (!voice->loop || sound->numFrames == 0)
             {
-                uint64_t sampleIndex = currentFrame * sound->numChannels + (j < sound->numChannels ? j : sound->numChannels - 1);
-                ((float*)outputBuffer)[i * audio->numChannels + j] += 0.1f * sound->samples[sampleIndex];
+                finishVoice(audio, voice);
+                return;
             }
+            voice->cursor = 0;
+        }
+
+        uint32_t count = numFrames - mixedFrames;
+        if (count > sound->numFrames - voice->cursor)
+        {
+            count = sound->numFrames - voice->cursor;
+        }
+        mixFrames(output + (size_t)mixedFrames * audio->numChannels, audio->numChannels,
+            sound->samples + (size_t)voice->cursor * sound->numChannels, sound->numChannels, count, gain);
+        mixedFrames += count;
+        voice->cursor += count;
+    }
+}
+
+static void mixStreamVoice(Audio* audio, Voice* voice, float* output, uint32_t numFrames)
+{
+    // frames the decoder hasn't caught up on are left silent rather than waited for
+    SoundStream* stream = voice->stream;
+    uint32_t numChannels = soundStreamGetNumChannels(stream);
+    float gain = audio->volume * voice->gain;
+    uint32_t mixedFrames = 0;
+    while (mixedFrames < numFrames)
+    {
+        const float* samples;
+        uint32_t count = soundStreamPeek(stream, &samples);
+        if (count == 0)
+        {
+            break;
+        }
+        if (count > numFrames - mixedFrames)
+        {
+            count = numFrames - mixedFrames;
+        }
+        mixFrames(output + (size_t)mixedFrames * audio->numChannels, audio->numChannels, samples, numChannels, count, gain);
+        soundStreamConsume(stream, count);
+        mixedFrames += count;
+    }
+
+    if (soundStreamEnded(stream))
+    {
+        finishVoice(audio, voice);
+    }
+}
+
+static int streamCallback(const void* inputBuffer, void* outputBuffer, unsigned long framesPerBuffer, const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void* userData)
+{
+    Audio* audio = userData;
+
+    processCommands(audio);
+    memset(outputBuffer, 0, sizeof(float) * audio->numChannels * framesPerBuffer);
+
+    for (uint32_t i = 0; i < MAX_VOICES; ++i)
+    {
+        if (audio->voices[i].stream)
+        {
+            mixStreamVoice(audio, &audio->voices[i], outputBuffer, framesPerBuffer);
+        }
+        else if (audio->voices[i].active)
+        {
+            mixVoice(audio, &audio->voices[i], outputBuffer, framesPerBuffer);
         }
     }
 
@@ -108,11 +247,9 @@ static const char* const PREFERRED_DEVICES[] = {
 bool initAudio(Audio* audio)
 {
     memset(audio, 0, sizeof(*audio));
-
-    audio->playing = 0;
-    audio->lastPlaying = 1;
-    audio->editing = 2;
-    currentBuffer = &audio->buffers[audio->playing];
+    audioQueueInit(&audio->commands);
+    audioQueueInit(&audio->finished);
+    audio->volume = 0.1f;
 
     PaError error;
     if ((error = Pa_Initialize()) != paNoError)
@@ -202,15 +339,29 @@ void cleanupAudio(Audio* audio)
         fprintf(stderr, "Failed to terminate PortAudio: %s\n", Pa_GetErrorText(error));
     }
 
-    for (int i = 0; i < 3; ++i)
+    // the stream is closed, so nothing reads the voices or queues anymore. plays that were still queued,
+    // playing, or finished each hold a reference to their sound
+    AudioCommand command;
+    while (audioQueuePop(&audio->commands, &command))
+    {
+        if (command.type == AUDIO_COMMAND_PLAY)
+        {
+            freeSound(command.sound);
+        }
+    }
+    while (audioQueuePop(&audio->finished, &command))
+    {
+        freeSound(command.sound);
+    }
+    for (uint32_t i = 0; i < MAX_VOICES; ++i)
     {
-        for (uint32_t j = 0; j < audio->buffers[i].numSounds; ++j)
+        if (audio->voices[i].active)
         {
-            free(audio->buffers[i].sounds[j]);
-            audio->buffers[i].sounds[j] = NULL;
+            freeSound((Sound*)audio->voices[i].sound);
         }
-        audio->buffers[i].numSounds = 0;
     }
+    memset(audio->voices, 0, sizeof(audio->voices));
+    audio->numInFlight = 0;
 }
 
 bool startAudioStream(Audio* audio)
@@ -263,7 +414,7 @@ Sound* newSound(const char* filename, bool loop)
     sound->numChannels = info->channels;
     sound->samples = malloc(sizeof(float) * sound->numChannels * sound->numFrames);
     sound->loop = loop;
-    sound->finished = false;
+    atomic_init(&sound->refCount, 1);
 
     bool error = false;
     size_t totalRead = 0;
@@ -299,9 +450,36 @@ Sound* newSound(const char* filename, bool loop)
     return sound;
 }
 
+Sound* newSoundFromPCM16(const int16_t* samples, uint32_t numFrames, uint32_t numChannels, bool loop)
+{
+    Sound* sound = malloc(sizeof(Sound));
+    sound->numFrames = numFrames;
+    sound->numChannels = numChannels;
+    sound->samples = malloc(sizeof(float) * numChannels * numFrames);
+    sound->loop = loop;
+    atomic_init(&sound->refCount, 1);
+
+    for (size_t i = 0; i < (size_t)numChannels * numFrames; ++i)
+    {
+        sound->samples[i] = samples[i] / 32767.0f;
+    }
+
+    return sound;
+}
+
+Sound* retainSound(Sound* sound)
+{
+    if (sound)
+    {
+        atomic_fetch_add_explicit(&sound->refCount, 1, memory_order_relaxed);
+    }
+    return sound;
+}
+
 void freeSound(Sound* sound)
 {
-    if (!sound)
+    // acq_rel so whichever thread drops the last reference sees every other owner's use of the samples as done
+    if (!sound || atomic_fetch_sub_explicit(&sound->refCount, 1, memory_order_acq_rel) != 1)
     {
         return;
     }
@@ -309,43 +487,69 @@ void freeSound(Sound* sound)
     free(sound);
 }
 
+const float* getSoundSamples(const Sound* sound)
+{
+    return sound->samples;
+}
+
+uint32_t getSoundNumFrames(const Sound* sound)
+{
+    return sound->numFrames;
+}
+
+uint32_t getSoundNumChannels(const Sound* sound)
+{
+    return sound->numChannels;
+}
+
 void audioUpdate(Audio* audio)
 {
-    if (audio->dirty)
+    AudioCommand command;
+    while (audioQueuePop(&audio->finished, &command))
     {
-        currentBuffer = &audio->buffers[audio->editing];
-        int nextEditing = audio->lastPlaying;
-        audio->lastPlaying = audio->playing;
-        audio->playing = audio->editing;
-        audio->editing = nextEditing;
-
-        Sound* prevSounds[256];
-        memcpy(prevSounds, audio->buffers[audio->editing].sounds, sizeof(prevSounds));
-        uint32_t count = 0; 
-        for (uint32_t i = 0; i < audio->buffers[audio->editing].numSounds; ++i)
+        // the voice's reference, taken when the play was queued
+        freeSound(command.sound);
+        --audio->numInFlight;
+    }
+}
+
+void audioPlaySound(Audio* audio, Sound* sound, float gain)
+{
+    // dropped when every voice is taken
+    if (sound && audio->numInFlight < MAX_VOICES)
+    {
+        AudioCommand command = { AUDIO_COMMAND_PLAY, retainSound(sound), gain };
+        if (audioQueuePush(&audio->commands, &command))
         {
-            if (!prevSounds[i]->finished)
-            {
-                audio->buffers[audio->editing].sounds[count++] = prevSounds[i];
-            }
-            else
-            {
-                free(prevSounds[i]);
-            }
+            ++audio->numInFlight;
+        }
+        else
+        {
+            freeSound(sound);
         }
-        audio->buffers[audio->editing].numSounds = count;
-
-        audio->dirty = false;
     }
 }
 
-void audioPlaySound(Audio* audio, Sound* sound)
+void audioStopAllSounds(Audio* audio)
 {
-    if (audio->buffers[audio->editing].numSounds < 256)
+    AudioCommand command = { AUDIO_COMMAND_STOP_ALL, NULL, 0.0f };
+    audioQueuePush(&audio->commands, &command);
+}
+
+void audioSetVolume(Audio* audio, float volume)
+{
+    AudioCommand command = { AUDIO_COMMAND_SET_VOLUME, NULL, volume };
+    audioQueuePush(&audio->commands, &command);
+}
+
+void audioPlayStream(Audio* audio, SoundStream* stream, float gain)
+{
+    if (stream && audio->numInFlight < MAX_VOICES)
     {
-        Sound* newSound = malloc(sizeof(Sound));
-        memcpy(newSound, sound, sizeof(Sound));
-        audio->buffers[audio->editing].sounds[audio->buffers[audio->editing].numSounds++] = newSound;
-        audio->dirty = true;
+        AudioCommand command = { AUDIO_COMMAND_PLAY_STREAM, NULL, gain, stream };
+        if (audioQueuePush(&audio->commands, &command))
+        {
+            ++audio->numInFlight;
+        }
     }
 }
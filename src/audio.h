@@ -5,9 +5,11 @@ extern "C" {
 #endif 
 
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct Audio Audio;
 typedef struct Sound Sound;
+typedef struct SoundStream SoundStream;
 
 Audio* newAudio(void);
 void freeAudio(Audio* audio);
@@ -18,11 +20,32 @@ void cleanupAudio(Audio* audio);
 bool startAudioStream(Audio* audio);
 bool stopAudioStream(Audio* audio);
 
+// sounds are reference counted. a new one holds one reference, and every voice playing it holds another
+// until audioUpdate sees it finish, so the samples outlive any playback
 Sound* newSound(const char* filename, bool loop);
+// from 16 bit samples, e.g. decoded earlier and cached
+Sound* newSoundFromPCM16(const int16_t* samples, uint32_t numFrames, uint32_t numChannels, bool loop);
+Sound* retainSound(Sound* sound);
+// drops a reference, the samples are freed with the last one
 void freeSound(Sound* sound);
 
+const float* getSoundSamples(const Sound* sound);
+uint32_t getSoundNumFrames(const Sound* sound);
+uint32_t getSoundNumChannels(const Sound* sound);
+
+// decodes on its own thread into a fixed-size buffer as it plays, for music and other long files.
+// a stream is a single playback: play it on one voice at a time, a stopped stream resumes where it was
+SoundStream* newSoundStream(const char* filename, bool loop);
+// only once no voice is playing it, e.g. after cleanupAudio
+void freeSoundStream(SoundStream* stream);
+
 void audioUpdate(Audio* audio);
-void audioPlaySound(Audio* audio, Sound* sound);
+// these only queue a command for the audio callback, so they never block or allocate.
+// every playback gets its own voice, so a sound can overlap itself
+void audioPlaySound(Audio* audio, Sound* sound, float gain);
+void audioPlayStream(Audio* audio, SoundStream* stream, float gain);
+void audioStopAllSounds(Audio* audio);
+void audioSetVolume(Audio* audio, float volume);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,161 @@
+#include "audio_assets.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "audio.h"
+#include "file_cache.hpp"
+
+static constexpr const char* AUDIO_CACHE_DIRECTORY = "audio_cache";
+
+// the cache file's header. interleaved 16 bit samples follow, half the size of the decoded floats
+struct SoundCacheHeader
+{
+    uint32_t numFrames;
+    uint32_t numChannels;
+};
+
+static std::string getCacheFilename(const std::string& filename)
+{
+    // one flat directory, so the source's path becomes part of the name
+    std::string name = filename;
+    std::replace_if(name.begin(), name.end(), [](char c) { return c == '/' || c == '\\' || c == ':'; }, '_');
+    return std::string(AUDIO_CACHE_DIRECTORY) + "/" + name + ".pcm";
+}
+
+static Sound* loadCachedSound(const std::string& cacheFilename, uint64_t key, bool loop)
+{
+    SoundCacheHeader header;
+    std::vector<char> payload;
+    std::vector<int16_t> samples;
+    if (!readCacheFile(cacheFilename, key, &header, sizeof(header), payload))
+    {
+        return nullptr;
+    }
+    samples.resize(static_cast<size_t>(header.numFrames) * header.numChannels);
+    if (payload.size() != samples.size() * sizeof(int16_t))
+    {
+        return nullptr;
+    }
+    std::memcpy(samples.data(), payload.data(), payload.size());
+    return newSoundFromPCM16(samples.data(), header.numFrames, header.numChannels, loop);
+}
+
+static void saveCachedSound(const Sound* sound, const std::string& cacheFilename, uint64_t key)
+{
+    SoundCacheHeader header = { getSoundNumFrames(sound), getSoundNumChannels(sound) };
+    const float* samples = getSoundSamples(sound);
+    std::vector<int16_t> pcm(static_cast<size_t>(header.numFrames) * header.numChannels);
+    for (size_t i = 0; i < pcm.size(); ++i)
+    {
+        pcm[i] = static_cast<int16_t>(std::lround(std::clamp(samples[i], -1.0f, 1.0f) * 32767.0f));
+    }
+    writeCacheFile(cacheFilename, key, &header, sizeof(header), pcm.data(), pcm.size() * sizeof(int16_t));
+}
+
+Sound* loadSound(const std::string& filename, bool loop)
+{
+    // keyed by the compressed file, which is much cheaper to hash than decoding it
+    std::ifstream source(filename, std::ios::binary);
+    if (!source)
+    {
+        return newSound(filename.c_str(), loop);
+    }
+    std::vector<char> sourceBytes((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+    uint64_t key = hashBytes(FNV_OFFSET_BASIS, sourceBytes.data(), sourceBytes.size());
+
+    std::string cacheFilename = getCacheFilename(filename);
+    if (Sound* sound = loadCachedSound(cacheFilename, key, loop))
+    {
+        return sound;
+    }
+
+    Sound* sound = newSound(filename.c_str(), loop);
+    if (sound)
+    {
+        saveCachedSound(sound, cacheFilename, key);
+    }
+    return sound;
+}
+
+AudioAssets::AudioAssets(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back(&AudioAssets::workerLoop, this);
+    }
+}
+
+AudioAssets::~AudioAssets()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    requestAdded.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    for (auto& request : requests)
+    {
+        freeSound(request.sound);
+    }
+}
+
+void AudioAssets::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        requestAdded.wait(lock, [&] { return stopping || nextRequest < requests.size(); });
+        if (stopping)
+        {
+            return;
+        }
+        auto& request = requests[nextRequest++];
+
+        // loading happens unlocked. nothing else touches a request until it is marked done
+        lock.unlock();
+        Sound* sound = loadSound(request.filename, request.loop);
+        lock.lock();
+
+        request.sound = sound;
+        request.done = true;
+        requestDone.notify_all();
+    }
+}
+
+AudioAssets::Request& AudioAssets::findOrAddRequest(const std::string& filename, bool loop)
+{
+    auto [it, added] = requestIndices.try_emplace(filename, requests.size());
+    if (added)
+    {
+        auto& request = requests.emplace_back();
+        request.filename = filename;
+        request.loop = loop;
+        requestAdded.notify_one();
+    }
+    return requests[it->second];
+}
+
+void AudioAssets::request(const std::string& filename, bool loop)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    findOrAddRequest(filename, loop);
+}
+
+Sound* AudioAssets::get(const std::string& filename, bool loop)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto& request = findOrAddRequest(filename, loop);
+    requestDone.wait(lock, [&] { return request.done; });
+    return retainSound(request.sound);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct Sound;
+
+// decodes straight from the .ogg, or reads the 16 bit samples cached from an earlier decode of the same file
+// contents. nullptr if the file can't be loaded
+Sound* loadSound(const std::string& filename, bool loop);
+
+// loads sounds on its own worker threads while the caller carries on. each file is loaded once and shared
+// by everything that asks for it, the manager keeps its reference until it is destroyed
+class AudioAssets
+{
+    struct Request
+    {
+        std::string filename;
+        bool loop = false;
+        Sound* sound = nullptr;
+        bool done = false;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable requestAdded;
+    std::condition_variable requestDone;
+    std::deque<Request> requests; // never shrinks, so references stay valid
+    std::unordered_map<std::string, size_t> requestIndices;
+    size_t nextRequest = 0;
+    bool stopping = false;
+
+    void workerLoop();
+    Request& findOrAddRequest(const std::string& filename, bool loop);
+
+public:
+    // 0 uses every hardware thread
+    explicit AudioAssets(uint32_t threadCount = 0);
+    ~AudioAssets();
+
+    // starts loading right away, unless the file was already requested. the first request decides whether it loops
+    void request(const std::string& filename, bool loop);
+
+    // blocks until the sound is loaded, requesting it first if needed. the caller gets its own reference,
+    // to drop with freeSound. nullptr if loading failed
+    Sound* get(const std::string& filename, bool loop = false);
+};
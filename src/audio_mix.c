@@ -0,0 +1,79 @@
+#include "audio_mix.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MIX_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MIX_SSE
+#endif
+
+// same layout on both sides, so frames can be treated as one flat run of samples
+static void mixContiguous(float* output, const float* source, uint32_t numSamples, float gain)
+{
+    uint32_t i = 0;
+#if defined(MIX_AVX)
+    __m256 gain8 = _mm256_set1_ps(gain);
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        __m256 mixed = _mm256_add_ps(_mm256_loadu_ps(output + i), _mm256_mul_ps(gain8, _mm256_loadu_ps(source + i)));
+        _mm256_storeu_ps(output + i, mixed);
+    }
+#elif defined(MIX_SSE)
+    __m128 gain4 = _mm_set1_ps(gain);
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        __m128 mixed = _mm_add_ps(_mm_loadu_ps(output + i), _mm_mul_ps(gain4, _mm_loadu_ps(source + i)));
+        _mm_storeu_ps(output + i, mixed);
+    }
+#endif
+    for (; i < numSamples; ++i)
+    {
+        output[i] += gain * source[i];
+    }
+}
+
+static void mixMonoToStereo(float* output, const float* source, uint32_t numFrames, float gain)
+{
+    uint32_t i = 0;
+#if defined(MIX_AVX) || defined(MIX_SSE)
+    // four mono samples become two registers of left/right pairs
+    __m128 gain4 = _mm_set1_ps(gain);
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        __m128 samples = _mm_mul_ps(gain4, _mm_loadu_ps(source + i));
+        __m128 low = _mm_unpacklo_ps(samples, samples);
+        __m128 high = _mm_unpackhi_ps(samples, samples);
+        _mm_storeu_ps(output + 2 * i, _mm_add_ps(_mm_loadu_ps(output + 2 * i), low));
+        _mm_storeu_ps(output + 2 * i + 4, _mm_add_ps(_mm_loadu_ps(output + 2 * i + 4), high));
+    }
+#endif
+    for (; i < numFrames; ++i)
+    {
+        float sample = gain * source[i];
+        output[2 * i] += sample;
+        output[2 * i + 1] += sample;
+    }
+}
+
+void mixFrames(float* output, uint32_t outputChannels, const float* source, uint32_t sourceChannels, uint32_t numFrames, float gain)
+{
+    if (sourceChannels == outputChannels)
+    {
+        mixContiguous(output, source, numFrames * outputChannels, gain);
+        return;
+    }
+    if (sourceChannels == 1 && outputChannels == 2)
+    {
+        mixMonoToStereo(output, source, numFrames, gain);
+        return;
+    }
+
+    for (uint32_t i = 0; i < numFrames; ++i)
+    {
+        for (uint32_t j = 0; j < outputChannels; ++j)
+        {
+            output[i * outputChannels + j] += gain * source[i * sourceChannels + (j < sourceChannels ? j : sourceChannels - 1)];
+        }
+    }
+}
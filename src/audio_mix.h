@@ -0,0 +1,17 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Adds gain * source into output, both interleaved. Output channels past the source's repeat its
+ * last channel, extra source channels are dropped. Mono and stereo sources into stereo output,
+ * and same-layout mixes, take a vectorized path on x86.
+ */
+void mixFrames(float* output, uint32_t outputChannels, const float* source, uint32_t sourceChannels, uint32_t numFrames, float gain);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,38 @@
+#include "audio_queue.h"
+
+void audioQueueInit(AudioQueue* queue)
+{
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
+
+bool audioQueuePush(AudioQueue* queue, const AudioCommand* command)
+{
+    // indices run freely and wrap, only their difference matters
+    uint_fast32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint_fast32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head >= AUDIO_QUEUE_CAPACITY)
+    {
+        return false;
+    }
+
+    queue->commands[tail & (AUDIO_QUEUE_CAPACITY - 1)] = *command;
+    // release publishes the command before the consumer can see the new tail
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool audioQueuePop(AudioQueue* queue, AudioCommand* command)
+{
+    uint_fast32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint_fast32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail)
+    {
+        return false;
+    }
+
+    *command = queue->commands[head & (AUDIO_QUEUE_CAPACITY - 1)];
+    // release lets the producer reuse the slot only after it has been read
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// must be a power of two
+#define AUDIO_QUEUE_CAPACITY 256
+
+typedef struct Sound Sound;
+typedef struct SoundStream SoundStream;
+
+typedef enum AudioCommandType
+{
+    AUDIO_COMMAND_PLAY,        // sound: played on a free voice, value: gain
+    AUDIO_COMMAND_PLAY_STREAM, // stream: played on a free voice, value: gain
+    AUDIO_COMMAND_STOP_ALL,
+    AUDIO_COMMAND_SET_VOLUME,  // value: master gain
+    AUDIO_COMMAND_FINISHED,    // callback to game thread. sound or stream: what the voice that just became free was playing
+} AudioCommandType;
+
+typedef struct AudioCommand
+{
+    AudioCommandType type;
+    Sound* sound;
+    float value;
+    SoundStream* stream;
+} AudioCommand;
+
+/* Bounded single producer, single consumer queue. Neither side ever blocks or allocates, so the
+ * audio callback can use it from the real-time thread. head is only written by the consumer and
+ * tail only by the producer, each on its own cache line.
+ */
+typedef struct AudioQueue
+{
+    alignas(64) atomic_uint_fast32_t head;
+    alignas(64) atomic_uint_fast32_t tail;
+    alignas(64) AudioCommand commands[AUDIO_QUEUE_CAPACITY];
+} AudioQueue;
+
+void audioQueueInit(AudioQueue* queue);
+
+// false if the queue is full
+bool audioQueuePush(AudioQueue* queue, const AudioCommand* command);
+
+// false if the queue is empty
+bool audioQueuePop(AudioQueue* queue, AudioCommand* command);
+
+#ifdef __cplusplus
+}
+#endif
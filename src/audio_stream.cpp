@@ -0,0 +1,161 @@
+#include "audio.h"
+#include "audio_stream.h"
+
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include <vorbis/vorbisfile.h>
+
+// the decoder thread is a std::thread, which every platform the game builds on has, unlike C11 threads.
+// everything here is still called through the C interface in audio.h and audio_stream.h
+
+// must be a power of two. about 0.7 seconds at 48kHz, 256KB of stereo samples
+static constexpr uint32_t STREAM_BUFFER_FRAMES = 32768;
+// the decoder tops the ring up in chunks of at most this many frames, and sleeps while there is no room for one
+static constexpr uint32_t STREAM_DECODE_FRAMES = 4096;
+static constexpr std::chrono::milliseconds STREAM_SLEEP_TIME(10);
+
+struct SoundStream
+{
+    OggVorbis_File file; // decoder thread only
+    std::thread thread;
+    uint32_t numChannels = 0;
+    bool loop = false;
+    std::vector<float> samples; // interleaved, STREAM_BUFFER_FRAMES frames
+    // frame counters run freely and wrap, only their difference matters
+    std::atomic<uint32_t> readFrame = 0; // written by the callback
+    std::atomic<uint32_t> writeFrame = 0; // written by the decoder
+    std::atomic<bool> ended = false; // set by the decoder once writeFrame won't move again
+    std::atomic<bool> stop = false;
+};
+
+static void decodeStream(SoundStream* stream)
+{
+    while (!stream->stop.load(std::memory_order_relaxed))
+    {
+        uint32_t writeFrame = stream->writeFrame.load(std::memory_order_relaxed);
+        uint32_t readFrame = stream->readFrame.load(std::memory_order_acquire);
+        uint32_t space = STREAM_BUFFER_FRAMES - (writeFrame - readFrame);
+        if (space < STREAM_DECODE_FRAMES)
+        {
+            std::this_thread::sleep_for(STREAM_SLEEP_TIME);
+            continue;
+        }
+
+        uint32_t offset = writeFrame & (STREAM_BUFFER_FRAMES - 1);
+        uint32_t count = std::min(STREAM_DECODE_FRAMES, STREAM_BUFFER_FRAMES - offset);
+
+        float** pcmChannels = nullptr;
+        int bitstream;
+        long numRead = ov_read_float(&stream->file, &pcmChannels, count, &bitstream);
+        if (numRead == OV_HOLE)
+        {
+            // a gap in the data, decoding picks up after it
+            continue;
+        }
+        if (numRead == 0 && stream->loop && ov_pcm_total(&stream->file, -1) > 0 && ov_pcm_seek(&stream->file, 0) == 0)
+        {
+            continue;
+        }
+        if (numRead <= 0)
+        {
+            if (numRead < 0)
+            {
+                std::fprintf(stderr, "Failed to read PCM data from stream\n");
+            }
+            break;
+        }
+
+        float* samples = stream->samples.data() + static_cast<size_t>(offset) * stream->numChannels;
+        for (long i = 0; i < numRead; ++i)
+        {
+            for (uint32_t j = 0; j < stream->numChannels; ++j)
+            {
+                samples[stream->numChannels * i + j] = pcmChannels[j][i];
+            }
+        }
+        // release publishes the samples before the callback can see the new write position
+        stream->writeFrame.store(writeFrame + numRead, std::memory_order_release);
+    }
+
+    stream->ended.store(true, std::memory_order_release);
+}
+
+SoundStream* newSoundStream(const char* filename, bool loop)
+{
+    auto* stream = new SoundStream;
+    if (ov_fopen(filename, &stream->file) != 0)
+    {
+        std::fprintf(stderr, "Failed to open OggVorbis file: %s\n", filename);
+        delete stream;
+        return nullptr;
+    }
+
+    stream->numChannels = ov_info(&stream->file, -1)->channels;
+    stream->loop = loop;
+    stream->samples.resize(static_cast<size_t>(stream->numChannels) * STREAM_BUFFER_FRAMES);
+
+    // the C interface can't throw, so a thread that fails to start is reported like a file that fails to open
+    try
+    {
+        stream->thread = std::thread(decodeStream, stream);
+    }
+    catch (const std::exception&)
+    {
+        std::fprintf(stderr, "Failed to start decoder thread for stream: %s\n", filename);
+        ov_clear(&stream->file);
+        delete stream;
+        return nullptr;
+    }
+
+    return stream;
+}
+
+void freeSoundStream(SoundStream* stream)
+{
+    if (!stream)
+    {
+        return;
+    }
+    stream->stop.store(true, std::memory_order_relaxed);
+    stream->thread.join();
+    ov_clear(&stream->file);
+    delete stream;
+}
+
+uint32_t soundStreamGetNumChannels(const SoundStream* stream)
+{
+    return stream->numChannels;
+}
+
+uint32_t soundStreamPeek(SoundStream* stream, const float** samples)
+{
+    uint32_t readFrame = stream->readFrame.load(std::memory_order_relaxed);
+    uint32_t writeFrame = stream->writeFrame.load(std::memory_order_acquire);
+    uint32_t offset = readFrame & (STREAM_BUFFER_FRAMES - 1);
+    uint32_t count = std::min(writeFrame - readFrame, STREAM_BUFFER_FRAMES - offset);
+    *samples = stream->samples.data() + static_cast<size_t>(offset) * stream->numChannels;
+    return count;
+}
+
+void soundStreamConsume(SoundStream* stream, uint32_t numFrames)
+{
+    uint32_t readFrame = stream->readFrame.load(std::memory_order_relaxed);
+    // release lets the decoder overwrite the frames only after they have been mixed
+    stream->readFrame.store(readFrame + numFrames, std::memory_order_release);
+}
+
+bool soundStreamEnded(SoundStream* stream)
+{
+    // ended is checked first, so the write position read after it is final
+    if (!stream->ended.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    return stream->readFrame.load(std::memory_order_relaxed) == stream->writeFrame.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct SoundStream SoundStream;
+
+/* The stream's decoder thread fills a ring buffer ahead of playback, and the audio callback only
+ * takes PCM out of it. These are the callback's side, the decoder is the only other user.
+ */
+
+uint32_t soundStreamGetNumChannels(const SoundStream* stream);
+
+// decoded frames ready at the read position, only up to the end of the ring so they are contiguous
+uint32_t soundStreamPeek(SoundStream* stream, const float** samples);
+
+// hands numFrames from the last peek back to the decoder
+void soundStreamConsume(SoundStream* stream, uint32_t numFrames);
+
+// the decoder reached the end of a non-looping file and every decoded frame has been consumed
+bool soundStreamEnded(SoundStream* stream);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,39 @@
+#include "file_cache.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+static constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ static_cast<const uint8_t*>(data)[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+bool readCacheFile(const std::string& filename, uint64_t key, void* header, size_t headerSize, std::vector<char>& payload)
+{
+    std::ifstream file(filename, std::ios::binary);
+    uint64_t fileKey;
+    if (!file.read(reinterpret_cast<char*>(&fileKey), sizeof(fileKey)) || fileKey != key
+            || !file.read(static_cast<char*>(header), headerSize))
+    {
+        return false;
+    }
+    payload.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+void writeCacheFile(const std::string& filename, uint64_t key, const void* header, size_t headerSize, const void* payload, size_t payloadSize)
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+    std::ofstream file(filename, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    file.write(static_cast<const char*>(header), headerSize);
+    file.write(static_cast<const char*>(payload), payloadSize);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// results that are slow to rebuild, like linked shader programs and decoded sounds, are kept on disk under a
+// key hashed from everything they were built from. a file is the key followed by a header and a payload,
+// both laid out by the caller
+
+static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+// FNV-1a. start from FNV_OFFSET_BASIS, or continue from an earlier result to hash several pieces
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size);
+
+// false if the file is missing, shorter than the header, or was written under another key.
+// payload receives the rest of the file
+bool readCacheFile(const std::string& filename, uint64_t key, void* header, size_t headerSize, std::vector<char>& payload);
+
+// creates the file's directory if needed. a missing cache only costs rebuilding, so failing to write isn't an error
+void writeCacheFile(const std::string& filename, uint64_t key, const void* header, size_t headerSize, const void* payload, size_t payloadSize);
@@ -9,6 +9,11 @@ public:
 
     virtual void update(GLFWwindow* window) = 0;
     virtual void draw() = 0;
+
+    // when pipelined, draw runs on another thread, concurrently with the next update.
+    // it then only reads what the last call to snapshot captured
+    virtual void setPipelined(bool pipelined) = 0;
+    virtual void snapshot() = 0;
 };
 
 extern Game* createGame();
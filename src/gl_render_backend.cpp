@@ -0,0 +1,351 @@
+#include "gl_render_backend.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "opengl_utils.hpp"
+#include "tilemap.hpp"
+
+static constexpr size_t MIN_INSTANCE_SEGMENT_SIZE = 65536;
+static constexpr GLuint INSTANCE_ATTRIBUTE_LOCATION = 2;
+static constexpr GLuint INSTANCE_ATTRIBUTE_COUNT = 9;
+static constexpr GLuint GLYPH_ATTRIBUTE_COUNT = 5;
+static constexpr GLuint64 FENCE_WAIT_TIMEOUT_NS = 1000000000;
+
+static void enableInstanceAttributes(GLuint count)
+{
+    for (GLuint location = INSTANCE_ATTRIBUTE_LOCATION; location < INSTANCE_ATTRIBUTE_LOCATION + count; ++location)
+    {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+}
+
+static void setInstanceAttributes(GLuint buffer, uintptr_t offset)
+{
+    // GL 3.3 has no base instance, so each batch points the attributes at its own range instead
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), reinterpret_cast<void*>(offset + offsetof(InstanceData, transform) + column * sizeof(glm::vec4)));
+    }
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + 4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(InstanceData), reinterpret_cast<void*>(offset + offsetof(InstanceData, color)));
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + 5, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), reinterpret_cast<void*>(offset + offsetof(InstanceData, texRect)));
+    glVertexAttribIPointer(INSTANCE_ATTRIBUTE_LOCATION + 6, 1, GL_INT, sizeof(InstanceData), reinterpret_cast<void*>(offset + offsetof(InstanceData, textureLayer)));
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + 7, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceData), reinterpret_cast<void*>(offset + offsetof(InstanceData, animationStart)));
+    glVertexAttribIPointer(INSTANCE_ATTRIBUTE_LOCATION + 8, 1, GL_UNSIGNED_INT, sizeof(InstanceData), reinterpret_cast<void*>(offset + offsetof(InstanceData, animation)));
+}
+
+static void setGlyphAttributes(GLuint buffer, uintptr_t offset)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphData), reinterpret_cast<void*>(offset + offsetof(GlyphData, origin)));
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + 1, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphData), reinterpret_cast<void*>(offset + offsetof(GlyphData, xAxis)));
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + 2, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphData), reinterpret_cast<void*>(offset + offsetof(GlyphData, yAxis)));
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + 3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphData), reinterpret_cast<void*>(offset + offsetof(GlyphData, color)));
+    glVertexAttribIPointer(INSTANCE_ATTRIBUTE_LOCATION + 4, 1, GL_UNSIGNED_INT, sizeof(GlyphData), reinterpret_cast<void*>(offset + offsetof(GlyphData, glyph)));
+}
+
+InstanceBufferManager::~InstanceBufferManager()
+{
+    for (auto fence : fences)
+    {
+        glDeleteSync(fence);
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+void InstanceBufferManager::allocate(size_t requiredSegmentSize)
+{
+    // fences only guard the old buffer, which GL keeps alive until pending draws are done with it
+    for (auto& fence : fences)
+    {
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    glDeleteBuffers(1, &buffer);
+
+    segmentSize = std::max(segmentSize, MIN_INSTANCE_SEGMENT_SIZE);
+    while (segmentSize < requiredSegmentSize)
+    {
+        segmentSize *= 2;
+    }
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (glExtensions.bufferStorage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glExtensions.bufferStorage(GL_ARRAY_BUFFER, FRAME_SEGMENTS * segmentSize, NULL, flags);
+        persistentPointer = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, FRAME_SEGMENTS * segmentSize, flags));
+        if (!persistentPointer)
+        {
+            throw std::runtime_error("Failed to persistently map instance buffer");
+        }
+    }
+    else
+    {
+        glBufferData(GL_ARRAY_BUFFER, FRAME_SEGMENTS * segmentSize, NULL, GL_STREAM_DRAW);
+        persistentPointer = nullptr;
+    }
+}
+
+FrameUpload InstanceBufferManager::beginFrameUpload(size_t instanceCount, size_t glyphCount)
+{
+    frameIndex = (frameIndex + 1) % FRAME_SEGMENTS;
+
+    glyphOffset = instanceCount * sizeof(InstanceData);
+    size_t requiredSegmentSize = glyphOffset + glyphCount * sizeof(GlyphData);
+    if (!buffer || requiredSegmentSize > segmentSize)
+    {
+        allocate(requiredSegmentSize);
+    }
+
+    if (GLsync fence = fences[frameIndex])
+    {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT_NS) == GL_TIMEOUT_EXPIRED)
+        {
+        }
+        glDeleteSync(fence);
+        fences[frameIndex] = nullptr;
+    }
+
+    if (persistentPointer)
+    {
+        mappedPointer = persistentPointer + frameIndex * segmentSize;
+    }
+    else
+    {
+        // the fence already guarantees the GPU is done with this segment, so skip the driver's own synchronization
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        mappedPointer = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, frameIndex * segmentSize, segmentSize,
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+        if (!mappedPointer)
+        {
+            throw std::runtime_error("Failed to map instance buffer");
+        }
+    }
+    return { reinterpret_cast<InstanceData*>(mappedPointer), reinterpret_cast<GlyphData*>(mappedPointer + glyphOffset) };
+}
+
+void InstanceBufferManager::endFrameUpload()
+{
+    if (!persistentPointer && mappedPointer)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    mappedPointer = nullptr;
+}
+
+void InstanceBufferManager::fenceFrame()
+{
+    glDeleteSync(fences[frameIndex]);
+    fences[frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+GLRenderBackend::GLRenderBackend()
+{
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // binaries are cached across runs, so shaders are only compiled after they or the driver change
+    const ShaderSource vertexShader = { "shaders/vertex.glsl", GL_VERTEX_SHADER };
+    const ShaderSource textVertexShader = { "shaders/text_vertex.glsl", GL_VERTEX_SHADER };
+    const ShaderSource fragmentShader = { "shaders/fragment.glsl", GL_FRAGMENT_SHADER };
+    const ShaderSource arrayFragmentShader = { "shaders/fragment.glsl", GL_FRAGMENT_SHADER, "#define TEXTURE_ARRAY\n" };
+    const ShaderSource tilemapVertexShader = { "shaders/tilemap_vertex.glsl", GL_VERTEX_SHADER };
+    const ShaderSource tilemapFragmentShader = { "shaders/tilemap_fragment.glsl", GL_FRAGMENT_SHADER };
+    programs[static_cast<size_t>(RenderProgram::Sprite)] = loadShaderProgram({ vertexShader, fragmentShader }, "sprite");
+    programs[static_cast<size_t>(RenderProgram::SpriteArray)] = loadShaderProgram({ vertexShader, arrayFragmentShader }, "sprite_array");
+    programs[static_cast<size_t>(RenderProgram::Text)] = loadShaderProgram({ textVertexShader, fragmentShader }, "text");
+    programs[static_cast<size_t>(RenderProgram::Tilemap)] = loadShaderProgram({ tilemapVertexShader, tilemapFragmentShader }, "tilemap");
+
+    // instances are normally uploaded with the camera already applied, so viewProjection stays the identity
+    // except while drawing static instances
+    for (size_t i = 0; i < programs.size(); ++i)
+    {
+        glUseProgram(programs[i]);
+        glUniform1i(glGetUniformLocation(programs[i], "textureSampler"), 0);
+        viewProjectionLocations[i] = glGetUniformLocation(programs[i], "viewProjection");
+        useTextureLocations[i] = glGetUniformLocation(programs[i], "useTexture");
+        timeLocations[i] = glGetUniformLocation(programs[i], "time");
+        glUniformMatrix4fv(viewProjectionLocations[i], 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+    }
+
+    fontRectLocation = glGetUniformLocation(programs[static_cast<size_t>(RenderProgram::Text)], "fontRect");
+
+    GLuint tilemapProgram = programs[static_cast<size_t>(RenderProgram::Tilemap)];
+    glUseProgram(tilemapProgram);
+    glUniform1i(glGetUniformLocation(tilemapProgram, "tileset"), 0);
+    glUniform1i(glGetUniformLocation(tilemapProgram, "tileMap"), 1);
+    tilemapOriginLocation = glGetUniformLocation(tilemapProgram, "origin");
+    tilemapTileSizeLocation = glGetUniformLocation(tilemapProgram, "tileSize");
+    tilemapMapSizeLocation = glGetUniformLocation(tilemapProgram, "mapSize");
+    tilemapColorLocation = glGetUniformLocation(tilemapProgram, "color");
+
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    enableInstanceAttributes(INSTANCE_ATTRIBUTE_COUNT);
+
+    // glyph records have their own layout, so text gets its own vertex array
+    glGenVertexArrays(1, &glyphVertexArray);
+    glBindVertexArray(glyphVertexArray);
+    enableInstanceAttributes(GLYPH_ATTRIBUTE_COUNT);
+
+    // tilemap quads come from gl_VertexID, so they use a vertex array with nothing enabled
+    glGenVertexArrays(1, &tilemapVertexArray);
+}
+
+GLRenderBackend::~GLRenderBackend()
+{
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteVertexArrays(1, &glyphVertexArray);
+    glDeleteVertexArrays(1, &tilemapVertexArray);
+    glDeleteBuffers(1, &staticBuffer);
+    for (auto texture : tilemapTextures)
+    {
+        glDeleteTextures(1, &texture);
+    }
+    for (auto program : programs)
+    {
+        glDeleteProgram(program);
+    }
+    glDeleteTextures(1, &defaultFontTexture);
+}
+
+uint32_t GLRenderBackend::getDefaultFontTexture()
+{
+    if (!defaultFontTexture)
+    {
+        defaultFontTexture = loadTexture("textures/font.png");
+    }
+    return defaultFontTexture;
+}
+
+FrameUpload GLRenderBackend::beginFrameUpload(size_t instanceCount, size_t glyphCount)
+{
+    return instanceBufferManager.beginFrameUpload(instanceCount, glyphCount);
+}
+
+void GLRenderBackend::endFrameUpload()
+{
+    instanceBufferManager.endFrameUpload();
+}
+
+void GLRenderBackend::uploadStaticInstances(const std::vector<InstanceData>& instances)
+{
+    if (!staticBuffer)
+    {
+        glGenBuffers(1, &staticBuffer);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, staticBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData), instances.data(), GL_STATIC_DRAW);
+}
+
+void GLRenderBackend::uploadTilemap(uint32_t slot, const Tilemap& tilemap)
+{
+    if (slot >= tilemapTextures.size())
+    {
+        tilemapTextures.resize(slot + 1, 0);
+    }
+    auto& texture = tilemapTextures[slot];
+    if (!texture)
+    {
+        glGenTextures(1, &texture);
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, tilemap.width, tilemap.height, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, tilemap.tiles.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+}
+
+void GLRenderBackend::drawTilemap(const TilemapCommandData& data, const glm::mat4& viewProjection)
+{
+    const auto& tilemap = *data.tilemap;
+    glUniformMatrix4fv(viewProjectionLocations[static_cast<size_t>(RenderProgram::Tilemap)], 1, GL_FALSE, glm::value_ptr(viewProjection));
+    glUniform2fv(tilemapOriginLocation, 1, glm::value_ptr(tilemap.origin));
+    glUniform1f(tilemapTileSizeLocation, tilemap.tileSize);
+    glUniform2f(tilemapMapSizeLocation, tilemap.width, tilemap.height);
+    glUniform4fv(tilemapColorLocation, 1, glm::value_ptr(tilemap.color));
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, tilemapTextures[data.slot]);
+    glActiveTexture(GL_TEXTURE0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void GLRenderBackend::execute(const RenderCommandList& commandList, int windowWidth, int windowHeight, const glm::vec4& clearColor)
+{
+    glViewport(0, 0, windowWidth, windowHeight);
+    glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    size_t currentProgram = 0;
+    GLuint boundTexture = 0;
+    for (const auto& command : commandList.commands)
+    {
+        switch (command.type)
+        {
+        case RenderCommandType::UploadStaticInstances:
+            uploadStaticInstances(*commandList.staticInstances);
+            break;
+        case RenderCommandType::UploadTilemap:
+            uploadTilemap(command.resource, *commandList.tilemaps[command.first].tilemap);
+            break;
+        case RenderCommandType::UseProgram:
+            currentProgram = static_cast<size_t>(command.program);
+            glUseProgram(programs[currentProgram]);
+            glUniform1f(timeLocations[currentProgram], commandList.time);
+            if (command.program == RenderProgram::Text)
+            {
+                glUniform4fv(fontRectLocation, 1, glm::value_ptr(commandList.fontRect));
+            }
+            glBindVertexArray(command.program == RenderProgram::Tilemap ? tilemapVertexArray
+                : (command.program == RenderProgram::Text ? glyphVertexArray : vertexArray));
+            break;
+        case RenderCommandType::BindTexture:
+            glBindTexture(command.textureType == TextureType::Texture2DArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, command.resource);
+            boundTexture = command.resource;
+            break;
+        case RenderCommandType::SetViewProjection:
+            glUniformMatrix4fv(viewProjectionLocations[currentProgram], 1, GL_FALSE, glm::value_ptr(commandList.matrices[command.resource]));
+            break;
+        case RenderCommandType::DrawInstances:
+            if (command.stream == InstanceStream::Static)
+            {
+                setInstanceAttributes(staticBuffer, command.first * sizeof(InstanceData));
+            }
+            else if (command.stream == InstanceStream::Glyph)
+            {
+                setGlyphAttributes(instanceBufferManager.getBuffer(), instanceBufferManager.getGlyphOffset() + command.first * sizeof(GlyphData));
+            }
+            else
+            {
+                setInstanceAttributes(instanceBufferManager.getBuffer(), instanceBufferManager.getFrameOffset() + command.first * sizeof(InstanceData));
+            }
+            // batches never mix textures, so untextured sprites are simply the ones drawn with texture 0
+            if (programUseTexture[currentProgram] != (boundTexture != 0))
+            {
+                programUseTexture[currentProgram] = (boundTexture != 0);
+                glUniform1i(useTextureLocations[currentProgram], programUseTexture[currentProgram]);
+            }
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, command.count, command.instanceCount);
+            break;
+        case RenderCommandType::DrawTilemap:
+        {
+            const auto& data = commandList.tilemaps[command.first];
+            drawTilemap(data, commandList.matrices[data.matrix]);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    instanceBufferManager.fenceFrame();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+
+#include "render_backend.hpp"
+
+// one buffer split into a segment per frame in flight. a segment is only rewritten once the fence
+// placed after the frame that last used it has signaled, so mapping never has to wait on the driver
+class InstanceBufferManager
+{
+    static constexpr int FRAME_SEGMENTS = 3;
+    GLuint buffer = 0;
+    size_t segmentSize = 0;
+    GLsync fences[FRAME_SEGMENTS] = {};
+    int frameIndex = 0;
+    size_t glyphOffset = 0; // glyph records follow the frame's instance records in each segment
+    char* persistentPointer = nullptr;
+    char* mappedPointer = nullptr;
+
+    void allocate(size_t requiredSegmentSize);
+
+public:
+    virtual ~InstanceBufferManager();
+
+    FrameUpload beginFrameUpload(size_t instanceCount, size_t glyphCount);
+    void endFrameUpload();
+    void fenceFrame();
+
+    GLuint getBuffer() const { return buffer; }
+    uintptr_t getFrameOffset() const { return frameIndex * segmentSize; }
+    uintptr_t getGlyphOffset() const { return getFrameOffset() + glyphOffset; }
+};
+
+class GLRenderBackend final : public RenderBackend
+{
+    static constexpr size_t PROGRAM_COUNT = static_cast<size_t>(RenderProgram::Count);
+    InstanceBufferManager instanceBufferManager;
+    GLuint staticBuffer = 0;
+    std::vector<GLuint> tilemapTextures;
+    std::array<GLuint, PROGRAM_COUNT> programs = {};
+    std::array<GLint, PROGRAM_COUNT> viewProjectionLocations = {};
+    std::array<GLint, PROGRAM_COUNT> useTextureLocations = {};
+    std::array<GLint, PROGRAM_COUNT> timeLocations = {};
+    std::array<GLint, PROGRAM_COUNT> programUseTexture = {};
+    GLint fontRectLocation;
+    GLint tilemapOriginLocation;
+    GLint tilemapTileSizeLocation;
+    GLint tilemapMapSizeLocation;
+    GLint tilemapColorLocation;
+    GLuint vertexArray;
+    GLuint glyphVertexArray;
+    GLuint tilemapVertexArray;
+    GLuint defaultFontTexture = 0;
+
+    void uploadStaticInstances(const std::vector<InstanceData>& instances);
+    void uploadTilemap(uint32_t slot, const Tilemap& tilemap);
+    void drawTilemap(const TilemapCommandData& data, const glm::mat4& viewProjection);
+
+public:
+    GLRenderBackend();
+    ~GLRenderBackend();
+
+    uint32_t getDefaultFontTexture() override;
+
+    FrameUpload beginFrameUpload(size_t instanceCount, size_t glyphCount) override;
+    void endFrameUpload() override;
+
+    void execute(const RenderCommandList& commandList, int windowWidth, int windowHeight, const glm::vec4& clearColor) override;
+};
@@ -0,0 +1,107 @@
+#include "image_loader.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+Image loadImage(const char* filename)
+{
+    int width, height, components;
+    stbi_uc* pixelData = stbi_load(filename, &width, &height, &components, STBI_rgb_alpha);
+    if (!pixelData)
+    {
+        throw std::runtime_error("Failed to load texture: " + std::string(filename));
+    }
+
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(pixelData, pixelData + 4 * width * height);
+    stbi_image_free(pixelData);
+
+    return image;
+}
+
+ImageLoader::ImageLoader(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back(&ImageLoader::workerLoop, this);
+    }
+}
+
+ImageLoader::~ImageLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    requestAdded.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ImageLoader::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        requestAdded.wait(lock, [&] { return stopping || nextRequest < requests.size(); });
+        if (stopping)
+        {
+            return;
+        }
+        auto& request = requests[nextRequest++];
+
+        // decoding happens unlocked. nothing else touches a request until it is marked done
+        lock.unlock();
+        Image image;
+        std::exception_ptr error;
+        try
+        {
+            image = loadImage(request.filename.c_str());
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        request.image = std::move(image);
+        request.error = error;
+        request.done = true;
+        requestDone.notify_all();
+    }
+}
+
+uint32_t ImageLoader::request(const std::string& filename)
+{
+    uint32_t ticket;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ticket = requests.size();
+        requests.emplace_back().filename = filename;
+    }
+    requestAdded.notify_one();
+    return ticket;
+}
+
+Image ImageLoader::wait(uint32_t ticket)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto& request = requests.at(ticket);
+    requestDone.wait(lock, [&] { return request.done; });
+    if (request.error)
+    {
+        std::rethrow_exception(request.error);
+    }
+    return std::move(request.image);
+}
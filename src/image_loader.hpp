@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// decoded RGBA8 pixels, rows top to bottom
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+Image loadImage(const char* filename);
+
+// decodes images on its own worker threads while the caller carries on, e.g. uploading images that are
+// already done. needs no GL context, results are handed back with wait
+class ImageLoader
+{
+    struct Request
+    {
+        std::string filename;
+        Image image;
+        std::exception_ptr error;
+        bool done = false;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable requestAdded;
+    std::condition_variable requestDone;
+    std::deque<Request> requests; // never shrinks, so references stay valid and tickets are indices
+    size_t nextRequest = 0;
+    bool stopping = false;
+
+    void workerLoop();
+
+public:
+    // 0 uses every hardware thread
+    explicit ImageLoader(uint32_t threadCount = 0);
+    ~ImageLoader();
+
+    // starts decoding right away and returns a ticket for wait
+    uint32_t request(const std::string& filename);
+
+    // blocks until the image is decoded and moves it out. rethrows if decoding failed
+    Image wait(uint32_t ticket);
+};
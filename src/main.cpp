@@ -1,9 +1,14 @@
+#include <condition_variable>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "game.hpp"
+#include "opengl_utils.hpp"
 
 struct GLFWWrapper
 {
@@ -32,6 +37,67 @@ static GLFWwindow* createWindow(int width, int height, const char* title)
     return window;
 }
 
+// events have to be handled on the main thread, so simulation stays here and the GL context moves to the
+// render thread. frame N is drawn from a snapshot while frame N + 1 is updated, at the cost of a frame of latency
+static void runPipelined(GLFWwindow* window, Game& game)
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool frameReady = false;
+    bool stop = false;
+
+    game.setPipelined(true);
+    glfwMakeContextCurrent(nullptr);
+
+    std::thread renderThread([&]
+    {
+        glfwMakeContextCurrent(window);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            condition.wait(lock, [&] { return frameReady || stop; });
+            if (stop)
+            {
+                break;
+            }
+            lock.unlock();
+
+            game.draw();
+            glfwSwapBuffers(window);
+
+            lock.lock();
+            frameReady = false;
+            condition.notify_all();
+        }
+        glfwMakeContextCurrent(nullptr);
+    });
+
+    while (!glfwWindowShouldClose(window))
+    {
+        glfwPollEvents();
+
+        game.update(window);
+
+        // the snapshot can only be replaced once the previous frame is done with it
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&] { return !frameReady; });
+        game.snapshot();
+        frameReady = true;
+        condition.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    condition.notify_all();
+    renderThread.join();
+
+    // the game's destructor still frees GL objects
+    glfwMakeContextCurrent(window);
+    game.setPipelined(false);
+}
+
 int main(int argc, char** argv)
 {
     GLFWWrapper glfwWrapper;
@@ -45,17 +111,26 @@ int main(int argc, char** argv)
     {
         throw std::runtime_error("gladLoadGL failed");
     }
+    loadGLExtensions(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 
     std::unique_ptr<Game> game(createGame());
 
-    while (!glfwWindowShouldClose(window))
+    // LD53_PIPELINED draws each frame on a render thread while the main thread updates the next one
+    if (std::getenv("LD53_PIPELINED"))
     {
-        glfwPollEvents();
+        runPipelined(window, *game);
+    }
+    else
+    {
+        while (!glfwWindowShouldClose(window))
+        {
+            glfwPollEvents();
 
-        game->update(window);
-        game->draw();
+            game->update(window);
+            game->draw();
 
-        glfwSwapBuffers(window);
+            glfwSwapBuffers(window);
+        }
     }
 
     return 0;
@@ -1,33 +1,152 @@
 #include "opengl_utils.hpp"
 
+#include <cstring>
 #include <fstream>
+#include <stdexcept>
+#include <string>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include "file_cache.hpp"
 
-GLuint loadTexture(const char* filename)
+static constexpr const char* SHADER_CACHE_DIRECTORY = "shader_cache";
+
+GLExtensions glExtensions;
+
+void loadGLExtensions(GLADloadproc loadProc)
+{
+    glExtensions = {};
+    if (hasGLExtension("GL_ARB_buffer_storage"))
+    {
+        glExtensions.bufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(loadProc("glBufferStorage"));
+    }
+    GLint binaryFormatCount = 0;
+    if (hasGLExtension("GL_ARB_get_program_binary"))
+    {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+    }
+    if (binaryFormatCount > 0)
+    {
+        glExtensions.getProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYPROC>(loadProc("glGetProgramBinary"));
+        glExtensions.programBinary = reinterpret_cast<PFNGLPROGRAMBINARYPROC>(loadProc("glProgramBinary"));
+        glExtensions.programParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC>(loadProc("glProgramParameteri"));
+    }
+}
+
+bool hasGLExtension(const char* name)
+{
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; ++i)
+    {
+        if (std::strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)), name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+PixelUploadBuffer::~PixelUploadBuffer()
 {
-    int width, height, components;
-    stbi_uc* pixelData = stbi_load(filename, &width, &height, &components, STBI_rgb_alpha);
-    if (!pixelData)
+    glDeleteBuffers(1, &buffer);
+}
+
+void PixelUploadBuffer::stage(const void* pixels, size_t size)
+{
+    if (!buffer)
+    {
+        glGenBuffers(1, &buffer);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    // orphaning gives fresh storage, so the previous upload can still be reading the old one
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    void* destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!destination)
     {
-        throw std::runtime_error("Failed to load texture: " + std::string(filename));
+        throw std::runtime_error("Failed to map pixel upload buffer");
+    }
+    std::memcpy(destination, pixels, size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+}
+
+void PixelUploadBuffer::unbind()
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void PixelUploadBuffer::deferMipmaps(GLenum target, GLuint texture)
+{
+    pendingMipmaps.emplace_back(target, texture);
+}
+
+void PixelUploadBuffer::finishUploads()
+{
+    for (auto [target, texture] : pendingMipmaps)
+    {
+        glBindTexture(target, texture);
+        glGenerateMipmap(target);
+    }
+    pendingMipmaps.clear();
+}
+
+void generateMipmaps(GLenum target, GLuint texture, PixelUploadBuffer* staging)
+{
+    if (staging)
+    {
+        staging->deferMipmaps(target, texture);
+    }
+    else
+    {
+        glGenerateMipmap(target);
+    }
+}
+
+GLuint createTexture(const Image& image, PixelUploadBuffer* staging)
+{
+    const void* pixels = image.pixels.data();
+    if (staging)
+    {
+        staging->stage(pixels, image.pixels.size());
+        pixels = nullptr;
     }
 
     GLuint texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixelData);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    if (staging)
+    {
+        PixelUploadBuffer::unbind();
+    }
+    generateMipmaps(GL_TEXTURE_2D, texture, staging);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    stbi_image_free(pixelData);
+    return texture;
+}
+
+GLuint createTexture(const TexturePack& pack, const TexturePackEntry& entry)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    for (uint32_t level = 0; level < entry.levelCount; ++level)
+    {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, getMipSize(entry.width, level), getMipSize(entry.height, level), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+            pack.getPixels(entry, level));
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry.levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
     return texture;
 }
 
-GLuint loadShader(const char* filename, GLenum shaderType)
+GLuint loadTexture(const char* filename)
+{
+    return createTexture(loadImage(filename));
+}
+
+static std::string readShaderSource(const char* filename, const char* defines)
 {
     std::ifstream fileStream(filename);
     if (!fileStream)
@@ -35,8 +154,17 @@ GLuint loadShader(const char* filename, GLenum shaderType)
         throw std::runtime_error("Failed to open file: " + std::string(filename));
     }
 
-    const std::string fileAsString{ std::istreambuf_iterator<char>(fileStream), std::istreambuf_iterator<char>() };
-    const char* source = fileAsString.c_str();
+    std::string fileAsString{ std::istreambuf_iterator<char>(fileStream), std::istreambuf_iterator<char>() };
+    if (defines)
+    {
+        fileAsString.insert(fileAsString.find('\n') + 1, defines);
+    }
+    return fileAsString;
+}
+
+static GLuint compileShader(const std::string& sourceString, GLenum shaderType, const char* filename)
+{
+    const char* source = sourceString.c_str();
     GLuint shader = glCreateShader(shaderType);
     glShaderSource(shader, 1, &source, nullptr);
     glCompileShader(shader);
@@ -55,9 +183,18 @@ GLuint loadShader(const char* filename, GLenum shaderType)
     return shader;
 }
 
-GLuint createShaderProgram(const std::vector<GLuint>& shaders)
+GLuint loadShader(const char* filename, GLenum shaderType, const char* defines)
+{
+    return compileShader(readShaderSource(filename, defines), shaderType, filename);
+}
+
+GLuint createShaderProgram(const std::vector<GLuint>& shaders, bool retrievableBinary)
 {
     GLuint program = glCreateProgram();
+    if (retrievableBinary && glExtensions.programParameteri)
+    {
+        glExtensions.programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
 
     for (const GLuint shader : shaders)
     {
@@ -84,3 +221,90 @@ GLuint createShaderProgram(const std::vector<GLuint>& shaders)
 
     return program;
 }
+
+// the cache file's header, the binary follows
+struct ProgramBinaryHeader
+{
+    uint32_t format;
+};
+
+static GLuint loadProgramBinary(const std::string& filename, uint64_t key)
+{
+    ProgramBinaryHeader header;
+    std::vector<char> binary;
+    if (!readCacheFile(filename, key, &header, sizeof(header), binary))
+    {
+        return 0;
+    }
+
+    // drivers may still refuse a binary, e.g. after an update that kept the version string
+    GLuint program = glCreateProgram();
+    glExtensions.programBinary(program, header.format, binary.data(), binary.size());
+    GLint linkStatus;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if (!linkStatus)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static void saveProgramBinary(GLuint program, const std::string& filename, uint64_t key)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+    ProgramBinaryHeader header = {};
+    std::vector<char> binary(length);
+    GLsizei writtenLength = 0;
+    glExtensions.getProgramBinary(program, length, &writtenLength, &header.format, binary.data());
+    writeCacheFile(filename, key, &header, sizeof(header), binary.data(), writtenLength);
+}
+
+GLuint loadShaderProgram(const std::vector<ShaderSource>& sources, const char* cacheName)
+{
+    // the key covers everything that could make a saved binary stale: the driver and every shader's final source
+    std::vector<std::string> sourceStrings;
+    uint64_t key = FNV_OFFSET_BASIS;
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        auto driverString = reinterpret_cast<const char*>(glGetString(name));
+        key = hashBytes(key, driverString, driverString ? std::strlen(driverString) + 1 : 0);
+    }
+    for (const auto& source : sources)
+    {
+        const auto& sourceString = sourceStrings.emplace_back(readShaderSource(source.filename, source.defines));
+        key = hashBytes(key, &source.type, sizeof(source.type));
+        key = hashBytes(key, sourceString.c_str(), sourceString.size() + 1);
+    }
+
+    bool useCache = glExtensions.programBinary && glExtensions.getProgramBinary;
+    std::string cacheFilename = std::string(SHADER_CACHE_DIRECTORY) + "/" + cacheName + ".bin";
+    if (useCache)
+    {
+        if (GLuint program = loadProgramBinary(cacheFilename, key))
+        {
+            return program;
+        }
+    }
+
+    std::vector<GLuint> shaders;
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        shaders.push_back(compileShader(sourceStrings[i], sources[i].type, sources[i].filename));
+    }
+    GLuint program = createShaderProgram(shaders, useCache);
+    for (auto shader : shaders)
+    {
+        glDeleteShader(shader);
+    }
+    if (useCache)
+    {
+        saveProgramBinary(program, cacheFilename, key);
+    }
+    return program;
+}
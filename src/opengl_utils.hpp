@@ -1,8 +1,85 @@
 #pragma once
 
+#include <cstdint>
+#include <utility>
 #include <vector>
 #include <glad/glad.h>
 
+#include "image_loader.hpp"
+#include "texture_pack.hpp"
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// entry points from extensions the 3.3 core glad loader doesn't know about. null when unsupported
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+struct GLExtensions
+{
+    PFNGLBUFFERSTORAGEPROC bufferStorage = nullptr;
+    // GL_ARB_get_program_binary. only loaded if the driver offers at least one binary format
+    PFNGLGETPROGRAMBINARYPROC getProgramBinary = nullptr;
+    PFNGLPROGRAMBINARYPROC programBinary = nullptr;
+    PFNGLPROGRAMPARAMETERIPROC programParameteri = nullptr;
+};
+
+extern GLExtensions glExtensions;
+
+void loadGLExtensions(GLADloadproc loadProc);
+bool hasGLExtension(const char* name);
+
+// a pixel unpack buffer that images are copied into before upload. the texture call then sources from
+// driver memory and returns without waiting for the transfer to the GPU.
+// generating mipmaps reads the uploaded level back, which would wait for the transfer after all, so
+// textures staged through here defer that to finishUploads, once every upload has been issued
+class PixelUploadBuffer
+{
+    GLuint buffer = 0;
+    std::vector<std::pair<GLenum, GLuint>> pendingMipmaps;
+
+public:
+    ~PixelUploadBuffer();
+
+    // leaves the buffer bound to GL_PIXEL_UNPACK_BUFFER, so pixel pointers given to glTex*Image are offsets into it
+    void stage(const void* pixels, size_t size);
+    static void unbind();
+
+    void deferMipmaps(GLenum target, GLuint texture);
+    // generates the deferred mipmaps. call before drawing with any texture staged here
+    void finishUploads();
+};
+
+// generates texture's mipmaps now, or defers them to staging if given
+void generateMipmaps(GLenum target, GLuint texture, PixelUploadBuffer* staging);
+
+// staging is optional, see PixelUploadBuffer
+GLuint createTexture(const Image& image, PixelUploadBuffer* staging = nullptr);
+// uploads every level straight from the pack's mapping, no mipmap generation needed
+GLuint createTexture(const TexturePack& pack, const TexturePackEntry& entry);
 GLuint loadTexture(const char* filename);
-GLuint loadShader(const char* filename, GLenum shaderType);
-GLuint createShaderProgram(const std::vector<GLuint>& shaders);
+// defines, if given, are inserted right after the #version line
+GLuint loadShader(const char* filename, GLenum shaderType, const char* defines = nullptr);
+// retrievableBinary hints that glGetProgramBinary will be called on the program
+GLuint createShaderProgram(const std::vector<GLuint>& shaders, bool retrievableBinary = false);
+
+struct ShaderSource
+{
+    const char* filename;
+    GLenum type;
+    const char* defines = nullptr; // see loadShader
+};
+
+// compiles and links the shaders, or loads the program binary saved by an earlier run under cacheName when the
+// sources and driver are unchanged. anything unusable in the cache is silently replaced
+GLuint loadShaderProgram(const std::vector<ShaderSource>& sources, const char* cacheName);
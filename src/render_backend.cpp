@@ -0,0 +1,53 @@
+#include "render_backend.hpp"
+
+#include <stdexcept>
+
+void RenderCommandList::clear()
+{
+    commands.clear();
+    matrices.clear();
+    tilemaps.clear();
+    staticInstances = nullptr;
+}
+
+FrameUpload NullRenderBackend::beginFrameUpload(size_t instanceCount, size_t glyphCount)
+{
+    frameInstances.resize(instanceCount);
+    frameGlyphs.resize(glyphCount);
+    return { frameInstances.data(), frameGlyphs.data() };
+}
+
+void NullRenderBackend::execute(const RenderCommandList& commandList, int windowWidth, int windowHeight, const glm::vec4& clearColor)
+{
+    recordedCommands = commandList.commands;
+    for (const auto& command : commandList.commands)
+    {
+        ++commandCounts[static_cast<size_t>(command.type)];
+        if (command.type == RenderCommandType::UploadStaticInstances)
+        {
+            staticInstances = *commandList.staticInstances;
+        }
+        else if (command.type == RenderCommandType::DrawInstances)
+        {
+            size_t recordCount = command.stream == InstanceStream::Static ? staticInstances.size()
+                : (command.stream == InstanceStream::Glyph ? frameGlyphs.size() : frameInstances.size());
+            if (command.first + command.instanceCount > recordCount)
+            {
+                throw std::runtime_error("Draw command reads past the uploaded instances");
+            }
+            drawnInstances += command.instanceCount;
+        }
+        else if (command.type == RenderCommandType::SetViewProjection && command.resource >= commandList.matrices.size())
+        {
+            throw std::runtime_error("View projection command refers to a missing matrix");
+        }
+    }
+    ++frames;
+}
+
+void NullRenderBackend::resetCounts()
+{
+    commandCounts = {};
+    drawnInstances = 0;
+    frames = 0;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct Tilemap;
+
+// per-instance vertex attributes, read with a divisor of 1
+struct InstanceData
+{
+    glm::mat4 transform;
+    uint32_t color; // RGBA8, read as normalized. whether to sample the texture is decided per draw
+    glm::vec4 texRect;
+    int32_t textureLayer;
+    float animationStart; // seconds, see SpriteAnimation
+    uint32_t animation; // frames per second in 1/256ths (bits 0-15), frame count (16-30), loop (31). 0 for still sprites
+};
+
+// one character of a string, drawn by the text program. the string's transform is applied once on the CPU,
+// so a glyph only carries the string's placement in clip space and its own cell
+struct GlyphData
+{
+    glm::vec2 origin;
+    glm::vec2 xAxis; // one character cell along the string
+    glm::vec2 yAxis;
+    uint32_t color; // RGBA8
+    uint32_t glyph; // column in the string << 8 | character code
+};
+
+// where the frame's records are written, until endFrameUpload
+struct FrameUpload
+{
+    InstanceData* instances = nullptr;
+    GlyphData* glyphs = nullptr;
+};
+
+// values double as the shader field of sort keys
+enum class RenderProgram : uint8_t
+{
+    Sprite,
+    Text,
+    SpriteArray,
+    Tilemap,
+    Count,
+};
+
+enum class TextureType : uint8_t
+{
+    Texture2D,
+    Texture2DArray,
+};
+
+enum class InstanceStream : uint8_t
+{
+    Frame, // written through beginFrameUpload every frame
+    Glyph, // likewise, but GlyphData records. text program only
+    Static, // RenderCommandList::staticInstances, as of the last UploadStaticInstances
+};
+
+enum class RenderCommandType : uint8_t
+{
+    UploadStaticInstances,
+    UploadTilemap, // resource: tilemap slot, first: index into RenderCommandList::tilemaps
+    UseProgram, // program
+    BindTexture, // textureType, resource: texture
+    SetViewProjection, // resource: index into RenderCommandList::matrices. sprite programs only
+    DrawInstances, // stream, first: first instance record, count: vertices per instance, instanceCount
+    DrawTilemap, // first: index into RenderCommandList::tilemaps
+    Count,
+};
+
+struct RenderCommand
+{
+    RenderCommandType type;
+    RenderProgram program = RenderProgram::Sprite;
+    TextureType textureType = TextureType::Texture2D;
+    InstanceStream stream = InstanceStream::Frame;
+    uint32_t resource = 0;
+    uint32_t first = 0;
+    uint32_t count = 0;
+    uint32_t instanceCount = 0;
+};
+
+struct TilemapCommandData
+{
+    const Tilemap* tilemap = nullptr;
+    uint32_t slot = 0;
+    uint32_t matrix = 0;
+};
+
+// one frame's worth of work for a backend. state commands are only recorded when the state changes,
+// so a backend can apply them as they come. everything referenced must stay alive until execute returns
+struct RenderCommandList
+{
+    std::vector<RenderCommand> commands;
+    std::vector<glm::mat4> matrices;
+    std::vector<TilemapCommandData> tilemaps;
+    const std::vector<InstanceData>* staticInstances = nullptr;
+    float time = 0; // seconds, drives sprite animation
+    glm::vec4 fontRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); // the font's region of its texture
+
+    void clear();
+};
+
+class RenderBackend
+{
+public:
+    virtual ~RenderBackend() = default;
+
+    // only asked for when text is drawn and no font was given with Renderer::setFont, so it can be loaded on first use
+    virtual uint32_t getDefaultFontTexture() = 0;
+
+    // the frame's instance and glyph records are written straight into the returned memory, until endFrameUpload
+    virtual FrameUpload beginFrameUpload(size_t instanceCount, size_t glyphCount) = 0;
+    virtual void endFrameUpload() = 0;
+
+    virtual void execute(const RenderCommandList& commandList, int windowWidth, int windowHeight, const glm::vec4& clearColor) = 0;
+};
+
+// keeps the last frame's commands and running totals instead of drawing anything, so the CPU side
+// of rendering can be benchmarked and checked without a GL context
+class NullRenderBackend final : public RenderBackend
+{
+    std::vector<InstanceData> frameInstances;
+    std::vector<GlyphData> frameGlyphs;
+    std::vector<InstanceData> staticInstances;
+    std::vector<RenderCommand> recordedCommands;
+    std::array<uint64_t, static_cast<size_t>(RenderCommandType::Count)> commandCounts = {};
+    uint64_t drawnInstances = 0;
+    uint64_t frames = 0;
+
+public:
+    uint32_t getDefaultFontTexture() override { return 1; }
+
+    FrameUpload beginFrameUpload(size_t instanceCount, size_t glyphCount) override;
+    void endFrameUpload() override {}
+
+    // throws if a draw reads instance records that weren't uploaded
+    void execute(const RenderCommandList& commandList, int windowWidth, int windowHeight, const glm::vec4& clearColor) override;
+
+    const std::vector<RenderCommand>& getRecordedCommands() const { return recordedCommands; }
+    const std::vector<InstanceData>& getFrameInstances() const { return frameInstances; }
+    const std::vector<GlyphData>& getFrameGlyphs() const { return frameGlyphs; }
+    uint64_t getCommandCount(RenderCommandType type) const { return commandCounts[static_cast<size_t>(type)]; }
+    uint64_t getDrawnInstances() const { return drawnInstances; }
+    uint64_t getFrames() const { return frames; }
+    void resetCounts();
+};
@@ -0,0 +1,136 @@
+#include "render_sort.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr uint32_t RADIX_BITS = 8;
+static constexpr uint32_t RADIX_BUCKETS = 1 << RADIX_BITS;
+static constexpr uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+static constexpr size_t SORT_REPAIR_DESCENT_FRACTION = 32;
+static constexpr size_t SORT_REPAIR_MIN_DESCENTS = 8;
+static constexpr size_t SORT_REPAIR_MOVES_PER_ENTRY = 2;
+
+static uint32_t orderedDepthBits(float depth)
+{
+    // flip the float bit pattern so unsigned integer comparison matches float comparison
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+uint64_t makeSortKey(uint32_t layer, float depth, uint32_t shader, uint32_t texture)
+{
+    return (static_cast<uint64_t>(std::min<uint32_t>(layer, 0xFF)) << 56) |
+        (static_cast<uint64_t>(orderedDepthBits(depth)) << 24) |
+        (static_cast<uint64_t>(shader & 0xFF) << 16) |
+        static_cast<uint64_t>(texture & 0xFFFF);
+}
+
+void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+    if (entries.size() < 2)
+    {
+        return;
+    }
+
+    // build all histograms in one pass over the keys
+    uint32_t counts[RADIX_PASSES][RADIX_BUCKETS] = {};
+    for (const auto& entry : entries)
+    {
+        for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass)
+        {
+            ++counts[pass][(entry.key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)];
+        }
+    }
+
+    scratch.resize(entries.size());
+    SortEntry* source = entries.data();
+    SortEntry* destination = scratch.data();
+    for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass)
+    {
+        uint32_t shift = pass * RADIX_BITS;
+
+        // every key has the same digit here, so this pass wouldn't move anything
+        if (counts[pass][(source[0].key >> shift) & (RADIX_BUCKETS - 1)] == entries.size())
+        {
+            continue;
+        }
+
+        uint32_t offsets[RADIX_BUCKETS];
+        uint32_t total = 0;
+        for (uint32_t bucket = 0; bucket < RADIX_BUCKETS; ++bucket)
+        {
+            offsets[bucket] = total;
+            total += counts[pass][bucket];
+        }
+
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            destination[offsets[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+        }
+        std::swap(source, destination);
+    }
+
+    if (source != entries.data())
+    {
+        entries.swap(scratch);
+    }
+}
+
+size_t countDescents(const SortEntry* first, const SortEntry* last)
+{
+    size_t descents = 0;
+    for (const SortEntry* entry = first; entry != last && entry + 1 != last; ++entry)
+    {
+        descents += (entry[0].key > entry[1].key);
+    }
+    return descents;
+}
+
+bool insertionSort(SortEntry* first, SortEntry* last, size_t maxMoves)
+{
+    size_t moves = 0;
+    for (SortEntry* entry = first; entry != last; ++entry)
+    {
+        SortEntry value = *entry;
+        SortEntry* hole = entry;
+        while (hole != first && (hole - 1)->key > value.key)
+        {
+            *hole = *(hole - 1);
+            --hole;
+            if (++moves > maxMoves)
+            {
+                *hole = value;
+                return false;
+            }
+        }
+        *hole = value;
+    }
+    return true;
+}
+
+SortPath repairSort(std::vector<SortEntry>& entries, size_t keptCount, std::vector<SortEntry>& scratch)
+{
+    auto* first = entries.data();
+    auto* middle = first + keptCount;
+    auto* last = first + entries.size();
+    size_t descents = countDescents(first, middle);
+    if (middle == last && descents == 0)
+    {
+        return SortPath::Unchanged;
+    }
+
+    // a few moving sprites only produce a few local descents, which insertion sort repairs in near linear time.
+    // new entries are sorted on their own and merged in
+    size_t maxDescents = keptCount / SORT_REPAIR_DESCENT_FRACTION + SORT_REPAIR_MIN_DESCENTS;
+    if (descents <= maxDescents && last - middle <= static_cast<ptrdiff_t>(maxDescents) &&
+        insertionSort(first, middle, SORT_REPAIR_MOVES_PER_ENTRY * keptCount) &&
+        insertionSort(middle, last, SORT_REPAIR_MOVES_PER_ENTRY * keptCount))
+    {
+        std::inplace_merge(first, middle, last, [] (const auto& entry0, const auto& entry1) { return entry0.key < entry1.key; });
+        return SortPath::Repaired;
+    }
+
+    radixSort(entries, scratch);
+    return SortPath::Full;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class SortPath
+{
+    Unchanged, Repaired, Full
+};
+
+struct SortEntry
+{
+    uint64_t key;
+    uint32_t index;
+};
+
+// key layout, most significant first: layer (8) | depth (32) | shader (8) | texture (16)
+uint64_t makeSortKey(uint32_t layer, float depth, uint32_t shader, uint32_t texture);
+
+// stable LSD radix sort by key. scratch is resized as needed and reused between calls
+void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+// number of adjacent pairs in [first, last) whose keys are out of order
+size_t countDescents(const SortEntry* first, const SortEntry* last);
+
+// stable insertion sort that gives up once more than maxMoves entries have been shifted.
+// returns false if it gave up, in which case the range is still a permutation of the input
+bool insertionSort(SortEntry* first, SortEntry* last, size_t maxMoves);
+
+// sorts entries whose first keptCount were in order last frame, with new entries after them. a few moved keys
+// are repaired with insertion sort and the new entries merged in, anything more falls back to radixSort
+SortPath repairSort(std::vector<SortEntry>& entries, size_t keptCount, std::vector<SortEntry>& scratch);
@@ -1,372 +1,574 @@
 #include "renderer.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
 #include <cstring>
+#include <limits>
+#include <ostream>
 #include <stdexcept>
-#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include "ecs.hpp"
 #include "scene_graph.hpp"
-#include "opengl_utils.hpp"
 
-static constexpr size_t INSTANCES_PER_UNIFORM_BUFFER  = 256;
-static constexpr size_t TEXT_VERTEX_BUFFER_SIZE  = 16384;
+static constexpr float STATIC_GRID_CELL_SIZE = 16.0f;
+static constexpr uint32_t IDENTITY_MATRIX = 0;
+static constexpr uint32_t INSTANCE_WRITE_CHUNK_SIZE = 2048;
+static constexpr uint32_t ANIMATION_FPS_SCALE = 256;
+static constexpr uint32_t ANIMATION_MAX_FPS = 0xffff;
+static constexpr uint32_t ANIMATION_MAX_FRAMES = 0x7fff;
 
-UniformBufferManager::UniformBufferManager()
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
 {
-    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
 }
 
-UniformBufferManager::~UniformBufferManager()
+void writeStatsHeader(std::ostream& stream)
 {
-    for (const auto& info : bufferInfos)
-    {
-        glDeleteBuffers(1, &info.buffer);
-    }
+    stream << "visible,culled,instances,batches,draw_calls,state_changes,uploaded_bytes,prepare_ms,render_ms\n";
 }
 
-void UniformBufferManager::beginFrameUpload()
+void writeStats(std::ostream& stream, const RenderStats& stats)
 {
-    for (auto i : inUseBuffers[frameIndex])
-    {
-        freeBuffers.push_back(i);
-    }
-    inUseBuffers[frameIndex].clear();
+    stream << stats.visibleInstances << ',' << stats.culledInstances << ',' << stats.instances << ',' << stats.batches << ','
+        << stats.drawCalls << ',' << stats.stateChanges << ',' << stats.uploadedBytes << ','
+        << stats.prepareMilliseconds << ',' << stats.renderMilliseconds << '\n';
 }
 
-void UniformBufferManager::endFrameUpload()
+static uint32_t packAnimation(const SpriteAnimation& animation)
 {
-    if (mappedPointer)
-    {
-        glUnmapBuffer(GL_UNIFORM_BUFFER);
-        mappedPointer = nullptr;
-    }
-    frameIndex = (frameIndex + 1) % 2;
+    auto fps = static_cast<uint32_t>(std::clamp(animation.framesPerSecond * ANIMATION_FPS_SCALE + 0.5f, 0.0f, static_cast<float>(ANIMATION_MAX_FPS)));
+    uint32_t frameCount = std::clamp(animation.frameCount, 1u, ANIMATION_MAX_FRAMES);
+    return fps | frameCount << 16 | (animation.loop ? 1u << 31 : 0u);
+}
+
+// text has no static glyph stream, so it is always drawn per frame
+static bool isBaked(const DrawInstance& instance)
+{
+    return instance.isBaked && !instance.isText;
 }
 
-void UniformBufferManager::prepareUpload(size_t requiredSize, UniformBufferInfo& rangeInfo)
+static RenderProgram getProgram(const DrawInstance& instance)
 {
-    UniformBufferInfo* info = nullptr;
-    if (currentBuffer < bufferInfos.size())
+    return instance.isText ? RenderProgram::Text : (instance.textureLayer >= 0 ? RenderProgram::SpriteArray : RenderProgram::Sprite);
+}
+
+Renderer::Renderer(RenderBackend& backend, SceneGraph& sceneGraph, const DrawInstanceManager& drawInstances,
+        const ComponentManager<TextInstance>& textInstances, const ComponentManager<Tilemap>& tilemaps) :
+    backend(backend),
+    sceneGraph(&sceneGraph),
+    drawInstances(&drawInstances),
+    textInstances(&textInstances),
+    tilemaps(&tilemaps),
+    staticGrid(STATIC_GRID_CELL_SIZE)
+{
+}
+
+const TextGlyphs& Renderer::updateTextGlyphs(uint32_t index)
+{
+    if (index >= textGlyphs.size())
     {
-        info = &bufferInfos[currentBuffer];
-        info->offset = (info->offset + uboAlignment - 1) & ~(uboAlignment - 1);
-        if (!info->offset + requiredSize < info->size)
-        {
-            glUnmapBuffer(GL_UNIFORM_BUFFER);
-            mappedPointer = nullptr;
-            info = nullptr;
-        }
+        textGlyphs.resize(index + 1);
     }
-    if (!info)
+    auto& entry = textGlyphs[index];
+    const auto& text = textInstances->get(index).text;
+    if (entry.text != text)
     {
-        if (!freeBuffers.empty())
+        entry.text = text;
+        entry.glyphs.clear();
+        for (uint32_t j = 0; j < text.size(); ++j)
         {
-            currentBuffer = freeBuffers.back();
-            freeBuffers.pop_back();
-            info = &bufferInfos[currentBuffer];
-            info->offset = 0;
-            glBindBuffer(GL_UNIFORM_BUFFER, info->buffer);
+            if (text[j] != ' ')
+            {
+                entry.glyphs.push_back(j << 8 | static_cast<uint8_t>(text[j]));
+            }
         }
-        else
+    }
+    return entry;
+}
+
+void Renderer::writeInstances(uint32_t firstEntry, uint32_t lastEntry, const FrameUpload& upload)
+{
+    // runs on worker threads. every sorted instance had its world transform resolved when its sort key was
+    // computed, so getWorldTransform only reads here, and each entry owns its own range of records
+    glm::mat4 matrix;
+    for (uint32_t entry = firstEntry; entry < lastEntry; ++entry)
+    {
+        auto index = sortIndices[entry];
+        const auto& instance = drawInstances->get(index);
+        uint32_t color = glm::packUnorm4x8(instance.color);
+        matrix = sceneGraph->getWorldTransform(index).computeMatrix();
+        matrix[0] *= instance.flipHorizontal ? -instance.size.x : instance.size.x;
+        matrix[1] *= instance.size.y;
+        matrix = layerCameras[instance.layer] * matrix;
+
+        if (!instance.isText)
         {
-            currentBuffer = bufferInfos.size();
-            info = &bufferInfos.emplace_back();
-            info->offset = 0;
-            info->size = INSTANCES_PER_UNIFORM_BUFFER * sizeof(glm::mat4);
-            glGenBuffers(1, &info->buffer);
-            glBindBuffer(GL_UNIFORM_BUFFER, info->buffer);
-            glBufferData(GL_UNIFORM_BUFFER, info->size, NULL, GL_STREAM_DRAW);
+            auto* instanceData = upload.instances + entryInstanceOffsets[entry];
+            instanceData->transform = matrix;
+            instanceData->color = color;
+            instanceData->texRect = instance.texRect;
+            instanceData->textureLayer = instance.textureLayer;
+            instanceData->animationStart = instance.animation.startTime;
+            instanceData->animation = packAnimation(instance.animation);
+            continue;
         }
-            
-        inUseBuffers[frameIndex].push_back(currentBuffer);
-        mappedPointer = glMapBuffer(GL_UNIFORM_BUFFER, GL_WRITE_ONLY);
-        if (!mappedPointer)
+
+        // the string's placement is shared by all its glyphs, which were cached in buildBatches
+        GlyphData glyphData;
+        glyphData.origin = glm::vec2(matrix[3]);
+        glyphData.xAxis = glm::vec2(matrix[0]);
+        glyphData.yAxis = glm::vec2(matrix[1]);
+        glyphData.color = color;
+        auto* glyphs = upload.glyphs + entryInstanceOffsets[entry];
+        for (auto glyph : textGlyphs[index].glyphs)
         {
-            throw std::runtime_error("Failed to map uniform buffer");
+            glyphData.glyph = glyph;
+            *glyphs++ = glyphData;
         }
     }
-
-    rangeInfo.buffer = info->buffer;
-    rangeInfo.offset = info->offset;
-    rangeInfo.size = requiredSize;
 }
 
-void UniformBufferManager::uploadData(const void* data, size_t size, size_t offset)
+uint64_t Renderer::computeSortKey(uint32_t index)
 {
-    memcpy(static_cast<char*>(mappedPointer) + bufferInfos[currentBuffer].offset, data, size);
-    bufferInfos[currentBuffer].offset += offset ? offset : size;
+    const auto& instance = drawInstances->get(index);
+    auto texture = instance.isText ? font.texture : instance.texture;
+    return makeSortKey(instance.layer, sceneGraph->getWorldTransform(index).depth, static_cast<uint32_t>(getProgram(instance)), texture);
 }
 
-TextBufferManager::~TextBufferManager()
+Bounds Renderer::computeBounds(uint32_t index)
 {
-    for (const auto& info : bufferInfos)
+    const auto& instance = drawInstances->get(index);
+    const auto& transform = sceneGraph->getWorldTransform(index);
+    float cosAngle = std::cos(transform.rotation);
+    float sinAngle = std::sin(transform.rotation);
+    glm::vec2 halfSize = 0.5f * instance.size;
+    glm::vec2 center = transform.position;
+    if (instance.isText)
     {
-        glDeleteBuffers(1, &info.vertexBuffer);
-        glDeleteVertexArrays(1, &info.vertexArray);
+        // text quads extend right and up from the origin, one unit per character
+        halfSize.x *= textInstances->get(index).text.size();
+        center += glm::vec2(cosAngle * halfSize.x - sinAngle * halfSize.y, sinAngle * halfSize.x + cosAngle * halfSize.y);
     }
+    glm::vec2 extent(std::abs(cosAngle) * halfSize.x + std::abs(sinAngle) * halfSize.y, std::abs(sinAngle) * halfSize.x + std::abs(cosAngle) * halfSize.y);
+    return { center - extent, center + extent };
 }
 
-void TextBufferManager::beginFrameUpload()
+void Renderer::markVisible(uint32_t index)
 {
-    for (auto i : inUseBuffers[frameIndex])
+    if (index >= visibleFrames.size())
     {
-        freeBuffers.push_back(i);
+        visibleFrames.resize(index + 1, 0);
+        sortFrames.resize(index + 1, 0);
     }
-    inUseBuffers[frameIndex].clear();
-}
-
-void TextBufferManager::endFrameUpload()
-{
-    if (mappedPointer)
+    if (visibleFrames[index] != sortFrame)
     {
-        glUnmapBuffer(GL_ARRAY_BUFFER);
-        mappedPointer = nullptr;
+        visibleFrames[index] = sortFrame;
+        visibleIndices.push_back(index);
     }
-    frameIndex = (frameIndex + 1) % 2;
 }
 
-void TextBufferManager::uploadData(const std::string& text, DrawBatch& batch)
+void Renderer::cullInstances(const std::vector<glm::mat4>& layerCameras)
 {
-    TextBufferInfo* info = nullptr;
-    size_t requiredSize = 4 * sizeof(glm::vec2) * text.size();
-    if (currentBuffer < bufferInfos.size())
+    ++sortFrame;
+    visibleIndices.clear();
+
+    layerViewBounds.resize(layerCameras.size());
+    for (uint32_t layer = 0; layer < layerCameras.size(); ++layer)
     {
-        info = &bufferInfos[currentBuffer];
-        if (!info->offset + requiredSize < info->size)
+        glm::mat4 inverseCamera = glm::inverse(layerCameras[layer]);
+        auto& bounds = layerViewBounds[layer];
+        bounds.min = glm::vec2(std::numeric_limits<float>::max());
+        bounds.max = glm::vec2(std::numeric_limits<float>::lowest());
+        for (const glm::vec2& corner : { glm::vec2(-1, -1), glm::vec2(1, -1), glm::vec2(-1, 1), glm::vec2(1, 1) })
         {
-            glUnmapBuffer(GL_ARRAY_BUFFER);
-            mappedPointer = nullptr;
-            info = nullptr;
+            glm::vec2 worldCorner(inverseCamera * glm::vec4(corner, 0, 1));
+            bounds.min = glm::min(bounds.min, worldCorner);
+            bounds.max = glm::max(bounds.max, worldCorner);
         }
     }
-    if (!info)
+
+    // dynamic instances get a bounds test every frame. static ones come from the grid below, baked ones aren't culled.
+    // a layer without a camera can't be drawn, so everything on it counts as culled
+    uint32_t bakedCount = 0;
+    for (auto index : drawInstances->indices())
     {
-        if (!freeBuffers.empty())
+        const auto& instance = drawInstances->get(index);
+        if (isBaked(instance))
         {
-            currentBuffer = freeBuffers.back();
-            freeBuffers.pop_back();
-            info = &bufferInfos[currentBuffer];
-            info->offset = 0;
-            info->currentIndex = 0;
-            glBindBuffer(GL_ARRAY_BUFFER, info->vertexBuffer);
+            ++bakedCount;
         }
-        else
+        else if (!instance.isStatic && instance.layer < layerViewBounds.size() && computeBounds(index).overlaps(layerViewBounds[instance.layer]))
         {
-            currentBuffer = bufferInfos.size();
-            info = &bufferInfos.emplace_back();
-            info->offset = 0;
-            info->currentIndex = 0;
-            info->size = TEXT_VERTEX_BUFFER_SIZE;
-            glGenBuffers(1, &info->vertexBuffer);
-            glBindBuffer(GL_ARRAY_BUFFER, info->vertexBuffer);
-            glBufferData(GL_ARRAY_BUFFER, info->size, NULL, GL_STREAM_DRAW);
-            glGenVertexArrays(1, &info->vertexArray);
-            glBindVertexArray(info->vertexArray);
-            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec2), reinterpret_cast<void*>(0));
-            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec2), reinterpret_cast<void*>(sizeof(glm::vec2)));
-            glEnableVertexAttribArray(0);
-            glEnableVertexAttribArray(1);
+            markVisible(index);
         }
-            
-        inUseBuffers[frameIndex].push_back(currentBuffer);
-        mappedPointer = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
-        if (!mappedPointer)
+    }
+
+    uint32_t staticGeneration = drawInstances->getStaticGeneration();
+    if (staticGridDirty || staticGeneration != staticGridGeneration)
+    {
+        staticGridItems.clear();
+        for (auto index : drawInstances->indices())
         {
-            throw std::runtime_error("Failed to map text buffer");
+            if (drawInstances->get(index).isStatic && !isBaked(drawInstances->get(index)))
+            {
+                staticGridItems.push_back({ index, computeBounds(index) });
+            }
         }
+        staticGrid.build(staticGridItems);
+        staticGridGeneration = staticGeneration;
+        staticGridDirty = false;
     }
+    bakedDirty = bakedDirty || staticGeneration != bakedGeneration;
+    uint32_t cullableCount = drawInstances->indices().size() - bakedCount;
 
-    glm::vec2 texCoordScale(1.0f / 16.0f, 1.0f / 8.0f);
-    for (uint32_t i = 0; i < text.size(); ++i)
+    for (uint32_t layer = 0; layer < layerViewBounds.size(); ++layer)
     {
-        glm::vec2 texCoord = texCoordScale * glm::vec2(text[i] >> 3, text[i] & 7);
-        const glm::vec2 vertexData[] {
-            { i, 1 }, texCoord, { i, 0 }, { texCoord.x, texCoord.y + texCoordScale.y },
-            { i + 1, 1 }, { texCoord.x + texCoordScale.x, texCoord.y }, { i + 1, 0 }, texCoord + texCoordScale,
-        };
-        memcpy(static_cast<char*>(mappedPointer) + info->offset, vertexData, sizeof(vertexData));
-        info->offset += sizeof(vertexData);
+        staticQueryResults.clear();
+        staticGrid.query(layerViewBounds[layer], staticQueryResults);
+        for (auto index : staticQueryResults)
+        {
+            if (drawInstances->has(index) && drawInstances->get(index).layer == layer)
+            {
+                markVisible(index);
+            }
+        }
     }
 
-    batch.vertexArray = info->vertexArray;
-    batch.firstIndex = info->currentIndex;
-    batch.count = text.size() * 4;
-
-    info->currentIndex += batch.count;
+    stats.visibleInstances = visibleIndices.size();
+    stats.culledInstances = cullableCount - stats.visibleInstances;
 }
 
-void TransformBufferManager::updateDrawBatch(const glm::mat4& cameraMatrix, SceneGraph& sceneGraph, const ComponentManager<DrawInstance>& drawInstances, const std::vector<uint32_t>& indices, DrawBatch& batch)
+void Renderer::updateSortOrder()
 {
-    if (batch.instanceCount > INSTANCES_PER_UNIFORM_BUFFER)
+    // start from last frame's order: refresh keys of instances that are still visible, then append newly visible ones
+    uint32_t keptCount = 0;
+    for (const auto& entry : sortEntries)
     {
-        throw std::runtime_error("Batch instance count exceeds max per buffer");
+        if (visibleFrames[entry.index] == sortFrame)
+        {
+            sortEntries[keptCount++] = { computeSortKey(entry.index), entry.index };
+            sortFrames[entry.index] = sortFrame;
+        }
     }
+    sortEntries.resize(keptCount);
 
-    size_t requiredSize = batch.instanceCount * sizeof(glm::mat4);
-    prepareUpload(requiredSize, batch.transformBufferInfo);
-
-    glm::mat4 matrix;
-    for (uint32_t i = 0; i < batch.instanceCount; ++i)
+    for (auto index : visibleIndices)
     {
-        auto index = indices[batch.firstInstance + i];
-        const auto& instance = drawInstances.get(index);
-        matrix = sceneGraph.getWorldTransform(index).computeMatrix();
-        matrix[0] *= instance.flipHorizontal ? -instance.size.x : instance.size.x;
-        matrix[1] *= instance.size.y;
-        matrix = cameraMatrix * matrix;
-        uploadData(glm::value_ptr(matrix), sizeof(matrix));
+        if (sortFrames[index] != sortFrame)
+        {
+            sortEntries.push_back({ computeSortKey(index), index });
+            sortFrames[index] = sortFrame;
+        }
     }
+
+    lastSortPath = repairSort(sortEntries, keptCount, sortScratch);
 }
 
-void MaterialBufferManager::updateDrawBatch(SceneGraph& sceneGraph, const ComponentManager<DrawInstance>& drawInstances, const std::vector<uint32_t>& indices, DrawBatch& batch)
+void Renderer::bakeStaticInstances()
 {
-    if (batch.instanceCount > INSTANCES_PER_UNIFORM_BUFFER)
+    // baked instances keep their world transforms, the camera is applied per layer when drawing
+    bakedEntries.clear();
+    for (auto index : drawInstances->indices())
     {
-        throw std::runtime_error("Batch instance count exceeds max per buffer");
+        if (isBaked(drawInstances->get(index)))
+        {
+            bakedEntries.push_back({ computeSortKey(index), index });
+        }
     }
+    radixSort(bakedEntries, sortScratch);
 
-    size_t requiredSize = batch.instanceCount * 2 * sizeof(glm::vec4);
-    prepareUpload(requiredSize, batch.materialBufferInfo);
-
-    int useTexture = (batch.texture != 0);
-    for (uint32_t i = 0; i < batch.instanceCount; ++i)
+    bakedBatches.clear();
+    bakedData.resize(bakedEntries.size());
+    for (uint32_t i = 0; i < bakedEntries.size(); ++i)
     {
-        auto index = indices[batch.firstInstance + i];
-        uploadData(glm::value_ptr(drawInstances.get(index).color), sizeof(glm::vec4));
-        uploadData(&useTexture, sizeof(int), sizeof(glm::vec4));
-    }
-}
-
-Renderer::Renderer(SceneGraph& sceneGraph, const ComponentManager<DrawInstance>& drawInstances, const ComponentManager<TextInstance>& textInstances) :
-    sceneGraph(sceneGraph),
-    drawInstances(drawInstances),
-    textInstances(textInstances)
-{
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    GLuint vertexShader = loadShader("shaders/vertex.glsl", GL_VERTEX_SHADER);
-    GLuint textVertexShader = loadShader("shaders/text_vertex.glsl", GL_VERTEX_SHADER);
-    GLuint fragmentShader = loadShader("shaders/fragment.glsl", GL_FRAGMENT_SHADER);
-    shaderProgram = createShaderProgram({ vertexShader, fragmentShader });
-    textProgram = createShaderProgram({ textVertexShader, fragmentShader });
-    glDeleteShader(vertexShader);
-    glDeleteShader(textVertexShader);
-    glDeleteShader(fragmentShader);
-
-    glUniformBlockBinding(shaderProgram, glGetUniformBlockIndex(shaderProgram, "TransformData"), 0);
-    glUniformBlockBinding(shaderProgram, glGetUniformBlockIndex(shaderProgram, "MaterialData"), 1);
-    glUniformBlockBinding(textProgram, glGetUniformBlockIndex(textProgram, "TransformData"), 0);
-    glUniformBlockBinding(textProgram, glGetUniformBlockIndex(textProgram, "MaterialData"), 1);
-
-    glUniform1i(glGetUniformLocation(shaderProgram, "textureSampler"), 0);
-    glUniform1i(glGetUniformLocation(textProgram, "textureSampler"), 0);
+        auto index = bakedEntries[i].index;
+        const auto& instance = drawInstances->get(index);
+        auto program = getProgram(instance);
+        if (bakedBatches.empty() || instance.layer != bakedBatches.back().layer || bakedBatches.back().texture != instance.texture
+                || bakedBatches.back().program != program)
+        {
+            auto& batch = bakedBatches.emplace_back();
+            batch.texture = instance.texture;
+            batch.textureType = instance.textureLayer >= 0 ? TextureType::Texture2DArray : TextureType::Texture2D;
+            batch.program = program;
+            batch.firstEntry = i;
+            batch.firstInstance = i;
+            batch.layer = instance.layer;
+        }
+        ++bakedBatches.back().entryCount;
+        ++bakedBatches.back().instanceCount;
 
-    glGenVertexArrays(1, &vertexArray);
+        glm::mat4 matrix = sceneGraph->getWorldTransform(index).computeMatrix();
+        matrix[0] *= instance.flipHorizontal ? -instance.size.x : instance.size.x;
+        matrix[1] *= instance.size.y;
+        bakedData[i].transform = matrix;
+        bakedData[i].color = glm::packUnorm4x8(instance.color);
+        bakedData[i].texRect = instance.texRect;
+        bakedData[i].textureLayer = instance.textureLayer;
+        bakedData[i].animationStart = instance.animation.startTime;
+        bakedData[i].animation = packAnimation(instance.animation);
+    }
 
-    fontTexture = loadTexture("textures/font.png");
+    bakedUploadPending = true;
+    bakedDirty = false;
+    bakedGeneration = drawInstances->getStaticGeneration();
 }
 
-Renderer::~Renderer()
+void Renderer::updateTilemaps()
 {
-    glDeleteVertexArrays(1, &vertexArray);
-    glDeleteProgram(shaderProgram);
+    // maps are only uploaded when their version changes, otherwise a tilemap costs nothing per frame
+    tilemapDraws.clear();
+    for (auto index : tilemaps->indices())
+    {
+        const auto& tilemap = tilemaps->get(index);
+        if (index >= tilemapVersions.size())
+        {
+            tilemapVersions.resize(index + 1);
+        }
+        auto& version = tilemapVersions[index];
+        if (!version.uploaded || version.version != tilemap.version)
+        {
+            commandList.tilemaps.push_back({ &tilemap, index, IDENTITY_MATRIX });
+            auto& command = commandList.commands.emplace_back();
+            command.type = RenderCommandType::UploadTilemap;
+            command.resource = index;
+            command.first = commandList.tilemaps.size() - 1;
+            version.version = tilemap.version;
+            version.uploaded = true;
+        }
+        if (tilemap.width > 0 && tilemap.height > 0 && tilemap.layer < layerCameras.size())
+        {
+            tilemapDraws.push_back(index);
+        }
+    }
+    std::stable_sort(tilemapDraws.begin(), tilemapDraws.end(), [this](uint32_t a, uint32_t b)
+    {
+        return tilemaps->get(a).layer < tilemaps->get(b).layer;
+    });
 }
 
-void Renderer::prepareRender(const std::vector<glm::mat4>& layerCameras)
+void Renderer::buildBatches()
 {
-    sortIndices.assign(drawInstances.indices().begin(), drawInstances.indices().end());
-    std::sort(sortIndices.begin(), sortIndices.end(),
-        [&] (auto index0, auto index1)
-        {
-            const auto& instance0 = drawInstances.get(index0);
-            const auto& instance1 = drawInstances.get(index1);
-            return (instance0.layer == instance1.layer && sceneGraph.getWorldTransform(index0).depth < sceneGraph.getWorldTransform(index1).depth) || instance0.layer < instance1.layer;
-        });
-
     batches.clear();
+    entryInstanceOffsets.resize(sortIndices.size());
+    frameInstanceCount = 0;
+    frameGlyphCount = 0;
     for (uint32_t i = 0; i < sortIndices.size(); ++i)
     {
-        const auto& instance = drawInstances.get(sortIndices[i]);
-        auto texture = instance.isText ? fontTexture : instance.texture;
+        const auto& instance = drawInstances->get(sortIndices[i]);
+        auto texture = instance.isText ? font.texture : instance.texture;
+        auto program = getProgram(instance);
 
-        if (batches.empty() || instance.isText || batches.back().instanceCount == INSTANCES_PER_UNIFORM_BUFFER || instance.layer > batches.back().layer || batches.back().texture != texture)
+        if (batches.empty() || instance.layer > batches.back().layer || batches.back().texture != texture
+                || batches.back().program != program)
         {
             auto& batch = batches.emplace_back();
             batch.texture = texture;
-            batch.firstInstance = i;
-            batch.instanceCount = 0;
+            batch.textureType = instance.textureLayer >= 0 ? TextureType::Texture2DArray : TextureType::Texture2D;
+            batch.program = program;
+            batch.firstEntry = i;
+            batch.firstInstance = instance.isText ? frameGlyphCount : frameInstanceCount;
             batch.layer = instance.layer;
+        }
 
-            if (!instance.isText)
-            {
-                batch.vertexArray = vertexArray;
-                batch.shaderProgram = shaderProgram;
-                batch.firstIndex = 0;
-                batch.count = 4;
-            }
-            else
-            {
-                batch.shaderProgram = textProgram;
-                textBufferManager.uploadData(textInstances.get(sortIndices[i]).text, batch);
-            }
+        auto& batch = batches.back();
+        ++batch.entryCount;
+        entryInstanceOffsets[i] = batch.firstInstance + batch.instanceCount;
+        if (!instance.isText)
+        {
+            ++batch.instanceCount;
+            ++frameInstanceCount;
+        }
+        else
+        {
+            uint32_t glyphCount = updateTextGlyphs(sortIndices[i]).glyphs.size();
+            batch.instanceCount += glyphCount;
+            frameGlyphCount += glyphCount;
         }
-        ++batches.back().instanceCount;
     }
+}
 
-    transformBufferManager.beginFrameUpload();
-    for (auto& batch : batches)
-    {
-        transformBufferManager.updateDrawBatch(layerCameras[batch.layer], sceneGraph, drawInstances, sortIndices, batch);
-    }
-    transformBufferManager.endFrameUpload();
+void Renderer::buildCommands()
+{
+    // matrix 0 is the identity, layer cameras follow
+    commandList.matrices.push_back(glm::mat4(1.0f));
+    commandList.matrices.insert(commandList.matrices.end(), layerCameras.begin(), layerCameras.end());
 
-    materialBufferManager.beginFrameUpload();
-    for (auto& batch : batches)
+    if (bakedUploadPending)
     {
-        materialBufferManager.updateDrawBatch(sceneGraph, drawInstances, sortIndices, batch);
+        commandList.staticInstances = &bakedData;
+        commandList.commands.push_back({ RenderCommandType::UploadStaticInstances });
+        bakedUploadPending = false;
     }
-    materialBufferManager.endFrameUpload();
-}
 
-void Renderer::render(int windowWidth, int windowHeight, const glm::vec4& clearColor)
-{
-    glViewport(0, 0, windowWidth, windowHeight);
-    glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a); 
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    GLuint boundTransformBuffer = 0;
-    GLuint boundMaterialBuffer = 0;
-    GLuint boundVertexArray = 0;
-    GLuint boundShaderProgram = 0;
-    for (const auto& batch : batches)
+    int32_t boundProgram = -1;
+    uint32_t boundTexture = 0;
+    auto setState = [&](RenderProgram program, TextureType textureType, uint32_t texture)
     {
-        if (batch.transformBufferInfo.buffer != boundTransformBuffer)
+        if (static_cast<int32_t>(program) != boundProgram)
         {
-            glBindBufferRange(GL_UNIFORM_BUFFER, 0, batch.transformBufferInfo.buffer, batch.transformBufferInfo.offset, batch.transformBufferInfo.size);
-            boundTransformBuffer = batch.transformBufferInfo.buffer;
+            auto& command = commandList.commands.emplace_back();
+            command.type = RenderCommandType::UseProgram;
+            command.program = program;
+            boundProgram = static_cast<int32_t>(program);
         }
 
-        if (batch.materialBufferInfo.buffer != boundMaterialBuffer)
+        if (texture != boundTexture)
         {
-            glBindBufferRange(GL_UNIFORM_BUFFER, 1, batch.materialBufferInfo.buffer, batch.materialBufferInfo.offset, batch.materialBufferInfo.size);
-            boundMaterialBuffer = batch.materialBufferInfo.buffer;
+            auto& command = commandList.commands.emplace_back();
+            command.type = RenderCommandType::BindTexture;
+            command.textureType = textureType;
+            command.resource = texture;
+            boundTexture = texture;
         }
+    };
 
-        if (batch.vertexArray != boundVertexArray)
+    auto addDraw = [&](const DrawBatch& batch, InstanceStream stream)
+    {
+        if (batch.program == RenderProgram::Text)
         {
-            glBindVertexArray(batch.vertexArray);
-            boundVertexArray = batch.vertexArray;
+            stream = InstanceStream::Glyph;
         }
+        auto& command = commandList.commands.emplace_back();
+        command.type = RenderCommandType::DrawInstances;
+        command.stream = stream;
+        command.first = batch.firstInstance;
+        command.count = 4;
+        command.instanceCount = batch.instanceCount;
+        ++stats.drawCalls;
+        stats.instances += batch.instanceCount;
+    };
+
+    auto addBakedDraw = [&](const DrawBatch& batch)
+    {
+        if (batch.layer >= layerCameras.size())
+        {
+            return;
+        }
+        setState(batch.program, batch.textureType, batch.texture);
+        commandList.commands.push_back({ RenderCommandType::SetViewProjection });
+        commandList.commands.back().resource = 1 + batch.layer;
+        addDraw(batch, InstanceStream::Static);
+        commandList.commands.push_back({ RenderCommandType::SetViewProjection });
+        commandList.commands.back().resource = IDENTITY_MATRIX;
+    };
+
+    auto addTilemapDraw = [&](uint32_t index)
+    {
+        const auto& tilemap = tilemaps->get(index);
+        setState(RenderProgram::Tilemap, TextureType::Texture2DArray, tilemap.tileset);
+        commandList.tilemaps.push_back({ &tilemap, index, 1 + tilemap.layer });
+        auto& command = commandList.commands.emplace_back();
+        command.type = RenderCommandType::DrawTilemap;
+        command.first = commandList.tilemaps.size() - 1;
+        ++stats.drawCalls;
+    };
+
+    // tilemaps and then baked batches go underneath everything else on their layer
+    stats.drawCalls = 0;
+    stats.instances = 0;
+    uint32_t nextTilemap = 0;
+    uint32_t nextBakedBatch = 0;
+    auto addGround = [&](uint32_t maxLayer)
+    {
+        for (; nextTilemap < tilemapDraws.size() && tilemaps->get(tilemapDraws[nextTilemap]).layer <= maxLayer; ++nextTilemap)
+        {
+            for (; nextBakedBatch < bakedBatches.size() && bakedBatches[nextBakedBatch].layer < tilemaps->get(tilemapDraws[nextTilemap]).layer; ++nextBakedBatch)
+            {
+                addBakedDraw(bakedBatches[nextBakedBatch]);
+            }
+            addTilemapDraw(tilemapDraws[nextTilemap]);
+        }
+        for (; nextBakedBatch < bakedBatches.size() && bakedBatches[nextBakedBatch].layer <= maxLayer; ++nextBakedBatch)
+        {
+            addBakedDraw(bakedBatches[nextBakedBatch]);
+        }
+    };
+
+    for (const auto& batch : batches)
+    {
+        addGround(batch.layer);
+        setState(batch.program, batch.textureType, batch.texture);
+        addDraw(batch, InstanceStream::Frame);
+    }
+    addGround(std::numeric_limits<uint32_t>::max());
+    stats.batches = batches.size() + bakedBatches.size() + tilemapDraws.size();
 
-        if (batch.shaderProgram != boundShaderProgram)
+    stats.stateChanges = 0;
+    stats.uploadedBytes = frameInstanceCount * sizeof(InstanceData) + frameGlyphCount * sizeof(GlyphData);
+    for (const auto& command : commandList.commands)
+    {
+        if (command.type == RenderCommandType::UseProgram || command.type == RenderCommandType::BindTexture
+                || command.type == RenderCommandType::SetViewProjection)
+        {
+            ++stats.stateChanges;
+        }
+        else if (command.type == RenderCommandType::UploadStaticInstances)
         {
-            glUseProgram(batch.shaderProgram);
-            boundShaderProgram = batch.shaderProgram;
+            stats.uploadedBytes += commandList.staticInstances->size() * sizeof(InstanceData);
         }
+        else if (command.type == RenderCommandType::UploadTilemap)
+        {
+            stats.uploadedBytes += commandList.tilemaps[command.first].tilemap->tiles.size() * sizeof(uint16_t);
+        }
+    }
+}
 
-        glBindTexture(GL_TEXTURE_2D, batch.texture);
-        glDrawArraysInstanced(GL_TRIANGLE_STRIP, batch.firstIndex, batch.count, batch.instanceCount);
+void Renderer::setScene(SceneGraph& sceneGraph, const DrawInstanceManager& drawInstances,
+    const ComponentManager<TextInstance>& textInstances, const ComponentManager<Tilemap>& tilemaps)
+{
+    this->sceneGraph = &sceneGraph;
+    this->drawInstances = &drawInstances;
+    this->textInstances = &textInstances;
+    this->tilemaps = &tilemaps;
+}
+
+void Renderer::prepareRender(const std::vector<glm::mat4>& layerCameras, float time)
+{
+    auto start = Clock::now();
+    this->layerCameras = layerCameras;
+    if (!font.texture && !textInstances->indices().empty())
+    {
+        font.texture = backend.getDefaultFontTexture();
     }
+    commandList.clear();
+    commandList.time = time;
+    commandList.fontRect = font.texRect;
+    cullInstances(layerCameras);
+    if (bakedDirty)
+    {
+        bakeStaticInstances();
+    }
+    updateTilemaps();
+    updateSortOrder();
+
+    sortIndices.resize(sortEntries.size());
+    for (uint32_t i = 0; i < sortEntries.size(); ++i)
+    {
+        sortIndices[i] = sortEntries[i].index;
+    }
+    buildBatches();
+
+    // entries are split evenly rather than by batch, since with the atlas one batch holds nearly everything
+    auto upload = backend.beginFrameUpload(frameInstanceCount, frameGlyphCount);
+    threadPool.parallelFor(sortIndices.size(), INSTANCE_WRITE_CHUNK_SIZE, [&] (uint32_t firstEntry, uint32_t lastEntry)
+    {
+        writeInstances(firstEntry, lastEntry, upload);
+    });
+    backend.endFrameUpload();
+
+    buildCommands();
+    stats.prepareMilliseconds = millisecondsSince(start);
+}
+
+void Renderer::render(int windowWidth, int windowHeight, const glm::vec4& clearColor)
+{
+    auto start = Clock::now();
+    backend.execute(commandList, windowWidth, windowHeight, clearColor);
+    stats.renderMilliseconds = millisecondsSince(start);
 }
@@ -1,19 +1,30 @@
 #pragma once
 
 #include <cstdint>
+#include <iosfwd>
 #include <string>
 #include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "ecs.hpp"
+#include "render_backend.hpp"
+#include "render_sort.hpp"
+#include "spatial_grid.hpp"
+#include "thread_pool.hpp"
+#include "texture_atlas.hpp"
+#include "tilemap.hpp"
+
 class SceneGraph;
-template<typename T> class ComponentManager;
 
-struct UniformBufferInfo
+// frames are laid out left to right, splitting the instance's texRect evenly between them. the shader picks
+// the current frame from the time, so animated sprites need no per-frame updates and keep batching
+struct SpriteAnimation
 {
-    GLuint buffer = 0;
-    uintptr_t offset = 0;
-    size_t size = 0;
+    uint32_t frameCount = 1; // at most 32767
+    float framesPerSecond = 0; // below 256, in steps of 1/256
+    float startTime = 0; // in the clock passed to Renderer::prepareRender
+    bool loop = true; // otherwise holds the last frame
 };
 
 struct DrawInstance
@@ -21,114 +32,161 @@ struct DrawInstance
     glm::vec2 size = glm::vec2(1.0f);
     glm::vec4 color = glm::vec4(1.0f);
     GLuint texture = 0;
+    glm::vec4 texRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); // part of texture to draw, see TextureRegion
+    int32_t textureLayer = -1; // >= 0 if texture is a GL_TEXTURE_2D_ARRAY
+    SpriteAnimation animation;
     bool flipHorizontal = false;
     uint32_t layer = 0;
     bool isText = false;
+    bool isStatic = false; // never moves once created. kept in a spatial index for culling
+    bool isBaked = false; // static ground that never needs sorting against other sprites, see Renderer::bakeStaticInstances. not text
 };
 
-struct DrawBatch
+// draw instances, plus a generation that moves whenever the set of static or baked instances may have changed.
+// the renderer only re-indexes them when it moves, and unlike comparing indices this can't be fooled by index reuse
+class DrawInstanceManager final : public ComponentManager<DrawInstance>
 {
-    uint32_t firstInstance = 0;
-    uint32_t instanceCount = 0;
-    GLuint texture = 0;
-    uint32_t layer = 0;
-    UniformBufferInfo transformBufferInfo;
-    UniformBufferInfo materialBufferInfo;
-    GLuint vertexArray = 0;
-    GLuint shaderProgram = 0;
-    GLint firstIndex = 0;
-    GLint count = 0;
-};
+    uint32_t staticGeneration = 0;
 
-struct TextInstance
-{
-    std::string text;
+public:
+    void destroy(uint32_t index) override
+    {
+        if (get(index).isStatic || get(index).isBaked)
+        {
+            ++staticGeneration;
+        }
+        ComponentManager<DrawInstance>::destroy(index);
+    }
+
+    // call after flagging a new instance static or baked, or moving or recoloring one
+    void invalidateStatic() { ++staticGeneration; }
+
+    uint32_t getStaticGeneration() const { return staticGeneration; }
 };
 
-struct TextRenderData
+struct DrawBatch
 {
-    GLuint vertexArray;
-    uint32_t count;
+    uint32_t firstEntry = 0; // range of sorted draw instances
+    uint32_t entryCount = 0;
+    uint32_t firstInstance = 0; // range of instance records, or of glyph records for text
+    uint32_t instanceCount = 0;
+    GLuint texture = 0;
+    TextureType textureType = TextureType::Texture2D;
+    RenderProgram program = RenderProgram::Sprite;
+    uint32_t layer = 0;
 };
 
-struct TextBufferInfo
+// the last frame's work. times are CPU time on the calling thread
+struct RenderStats
 {
-    GLuint vertexBuffer = 0;
-    GLuint vertexArray = 0;
-    uintptr_t offset = 0;
-    size_t size = 0;
-    uint32_t currentIndex = 0;
+    uint32_t visibleInstances = 0; // draw instances that passed culling. baked ones aren't culled and aren't counted
+    uint32_t culledInstances = 0;
+    uint32_t instances = 0; // instance records drawn: one per glyph for text, baked ones included
+    uint32_t batches = 0;
+    uint32_t drawCalls = 0;
+    uint32_t stateChanges = 0; // program, texture and view projection changes
+    uint64_t uploadedBytes = 0; // instance records, static instances and tilemaps
+    double prepareMilliseconds = 0;
+    double renderMilliseconds = 0;
 };
 
-class UniformBufferManager
-{
-    std::vector<UniformBufferInfo> bufferInfos;
-    std::vector<uint32_t> inUseBuffers[2];
-    std::vector<uint32_t> freeBuffers;
-    int frameIndex = 0;
-    uint32_t currentBuffer = 0;
-    void* mappedPointer = nullptr;
-    GLint uboAlignment = 1;
-
-public:
-    UniformBufferManager();
-    virtual ~UniformBufferManager();
-
-    void beginFrameUpload();
-    void endFrameUpload();
-    void prepareUpload(size_t requiredSize, UniformBufferInfo& rangeInfo);
-    void uploadData(const void* data, size_t size, size_t offset = 0);
-};
+// one comma separated line per frame, for scripts
+void writeStatsHeader(std::ostream& stream);
+void writeStats(std::ostream& stream, const RenderStats& stats);
 
-class TextBufferManager
+struct TextInstance
 {
-    std::vector<TextBufferInfo> bufferInfos;
-    std::vector<uint32_t> inUseBuffers[2];
-    std::vector<uint32_t> freeBuffers;
-    int frameIndex = 0;
-    uint32_t currentBuffer = 0;
-    void* mappedPointer = nullptr;
-
-public:
-    virtual ~TextBufferManager();
-
-    void beginFrameUpload();
-    void endFrameUpload();
-    void uploadData(const std::string& text, DrawBatch& batch);
+    std::string text;
 };
 
-class TransformBufferManager : public UniformBufferManager
+// a string's glyph records without its placement, rebuilt only when the string changes
+struct TextGlyphs
 {
-public:
-    void updateDrawBatch(const glm::mat4& cameraMatrix, SceneGraph& sceneGraph, const ComponentManager<DrawInstance>& drawInstances, const std::vector<uint32_t>& indices, DrawBatch& batch);
+    std::string text;
+    std::vector<uint32_t> glyphs; // see GlyphData::glyph. spaces are skipped
 };
 
-class MaterialBufferManager : public UniformBufferManager
+struct TilemapVersion
 {
-public:
-    void updateDrawBatch(SceneGraph& sceneGraph, const ComponentManager<DrawInstance>& drawInstances, const std::vector<uint32_t>& indices, DrawBatch& batch);
+    uint32_t version = 0;
+    bool uploaded = false;
 };
 
+// turns draw instances into a command list for a RenderBackend. all GPU work goes through the backend
 class Renderer
 {
-    SceneGraph& sceneGraph;
-    const ComponentManager<DrawInstance>& drawInstances;
-    const ComponentManager<TextInstance>& textInstances;
-    TransformBufferManager transformBufferManager;
-    MaterialBufferManager materialBufferManager;
-    TextBufferManager textBufferManager;
+    RenderBackend& backend;
+    SceneGraph* sceneGraph;
+    const DrawInstanceManager* drawInstances;
+    const ComponentManager<TextInstance>* textInstances;
+    const ComponentManager<Tilemap>* tilemaps;
+    RenderCommandList commandList;
     std::vector<DrawBatch> batches;
-    std::vector<TextRenderData> textRenderData;
+    std::vector<uint32_t> entryInstanceOffsets;
+    uint32_t frameInstanceCount = 0;
+    uint32_t frameGlyphCount = 0;
+    std::vector<TextGlyphs> textGlyphs;
+    ThreadPool threadPool;
+    std::vector<SortEntry> sortEntries;
+    std::vector<SortEntry> sortScratch;
     std::vector<uint32_t> sortIndices;
-    GLuint shaderProgram;
-    GLuint textProgram;
-    GLuint vertexArray;
-    GLuint fontTexture;
+    std::vector<uint32_t> sortFrames;
+    std::vector<uint32_t> visibleFrames;
+    std::vector<uint32_t> visibleIndices;
+    std::vector<Bounds> layerViewBounds;
+    SpatialGrid staticGrid;
+    std::vector<SpatialGridItem> staticGridItems;
+    std::vector<uint32_t> staticQueryResults;
+    uint32_t staticGridGeneration = 0;
+    bool staticGridDirty = true;
+    std::vector<InstanceData> bakedData;
+    std::vector<SortEntry> bakedEntries;
+    std::vector<DrawBatch> bakedBatches;
+    std::vector<glm::mat4> layerCameras;
+    std::vector<TilemapVersion> tilemapVersions;
+    std::vector<uint32_t> tilemapDraws;
+    uint32_t bakedGeneration = 0;
+    bool bakedDirty = true;
+    bool bakedUploadPending = false;
+    uint32_t sortFrame = 0;
+    SortPath lastSortPath = SortPath::Full;
+    TextureRegion font;
+    RenderStats stats;
+
+    uint64_t computeSortKey(uint32_t index);
+    Bounds computeBounds(uint32_t index);
+    void markVisible(uint32_t index);
+    void cullInstances(const std::vector<glm::mat4>& layerCameras);
+    void updateSortOrder();
+    void bakeStaticInstances();
+    void updateTilemaps();
+    void buildBatches();
+    const TextGlyphs& updateTextGlyphs(uint32_t index);
+    void writeInstances(uint32_t firstEntry, uint32_t lastEntry, const FrameUpload& upload);
+    void buildCommands();
 
 public:
-    Renderer(SceneGraph& sceneGraph, const ComponentManager<DrawInstance>& drawInstances, const ComponentManager<TextInstance>& textInstances);
-    ~Renderer();
+    Renderer(RenderBackend& backend, SceneGraph& sceneGraph, const DrawInstanceManager& drawInstances,
+        const ComponentManager<TextInstance>& textInstances, const ComponentManager<Tilemap>& tilemaps);
+
+    // switches to drawing other copies of the same entities, e.g. a snapshot taken for another thread.
+    // per-entity state carries over, so the new scene should use the same indices
+    void setScene(SceneGraph& sceneGraph, const DrawInstanceManager& drawInstances,
+        const ComponentManager<TextInstance>& textInstances, const ComponentManager<Tilemap>& tilemaps);
 
-    void prepareRender(const std::vector<glm::mat4>& layerCameras);
+    // time is in seconds, see SpriteAnimation
+    void prepareRender(const std::vector<glm::mat4>& layerCameras, float time);
     void render(int windowWidth, int windowHeight, const glm::vec4& clearColor);
+
+    const RenderCommandList& getCommandList() const { return commandList; }
+
+    // forces static and baked instances to be re-indexed, as when the scene's static generation moves
+    void invalidateStaticInstances() { staticGridDirty = true; bakedDirty = true; }
+
+    // the font, e.g. its region of an atlas. the texture stays owned by the caller. without one the backend's
+    // default font is loaded the first time text is drawn
+    void setFont(const TextureRegion& region) { font = region; }
+
+    SortPath getLastSortPath() const { return lastSortPath; }
+    const RenderStats& getStats() const { return stats; }
 };
@@ -0,0 +1,98 @@
+#include "spatial_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+static constexpr int32_t MAX_CELLS_PER_AXIS = 1024;
+
+SpatialGrid::SpatialGrid(float baseCellSize) :
+    baseCellSize(baseCellSize),
+    cellSize(baseCellSize)
+{
+}
+
+void SpatialGrid::build(const std::vector<SpatialGridItem>& items)
+{
+    itemCount = items.size();
+    cellStarts.clear();
+    cellItems.clear();
+    columns = 0;
+    rows = 0;
+    if (items.empty())
+    {
+        return;
+    }
+
+    Bounds total = items.front().bounds;
+    for (const auto& item : items)
+    {
+        total.min = glm::min(total.min, item.bounds.min);
+        total.max = glm::max(total.max, item.bounds.max);
+    }
+    // very large worlds get coarser cells rather than an unbounded cell count
+    glm::vec2 extent = total.max - total.min;
+    origin = total.min;
+    cellSize = std::max({ baseCellSize, extent.x / MAX_CELLS_PER_AXIS, extent.y / MAX_CELLS_PER_AXIS });
+    columns = std::max(static_cast<int32_t>(std::ceil(extent.x / cellSize)), 1);
+    rows = std::max(static_cast<int32_t>(std::ceil(extent.y / cellSize)), 1);
+
+    auto forEachCell = [&] (const Bounds& bounds, const auto& fn)
+    {
+        int32_t minColumn = std::clamp(static_cast<int32_t>((bounds.min.x - origin.x) / cellSize), 0, columns - 1);
+        int32_t maxColumn = std::clamp(static_cast<int32_t>((bounds.max.x - origin.x) / cellSize), 0, columns - 1);
+        int32_t minRow = std::clamp(static_cast<int32_t>((bounds.min.y - origin.y) / cellSize), 0, rows - 1);
+        int32_t maxRow = std::clamp(static_cast<int32_t>((bounds.max.y - origin.y) / cellSize), 0, rows - 1);
+        for (int32_t row = minRow; row <= maxRow; ++row)
+        {
+            for (int32_t column = minColumn; column <= maxColumn; ++column)
+            {
+                fn(row * columns + column);
+            }
+        }
+    };
+
+    // count, prefix sum, then fill, so every cell's items are contiguous
+    cellStarts.assign(columns * rows + 1, 0);
+    for (const auto& item : items)
+    {
+        forEachCell(item.bounds, [&] (int32_t cell) { ++cellStarts[cell + 1]; });
+    }
+    for (size_t i = 1; i < cellStarts.size(); ++i)
+    {
+        cellStarts[i] += cellStarts[i - 1];
+    }
+    cellItems.resize(cellStarts.back());
+    std::vector<uint32_t> cellCursors(cellStarts.begin(), cellStarts.end() - 1);
+    for (const auto& item : items)
+    {
+        forEachCell(item.bounds, [&] (int32_t cell) { cellItems[cellCursors[cell]++] = item.index; });
+    }
+}
+
+void SpatialGrid::query(const Bounds& bounds, std::vector<uint32_t>& results) const
+{
+    if (!columns || !rows)
+    {
+        return;
+    }
+
+    glm::vec2 minCell = (bounds.min - origin) / cellSize;
+    glm::vec2 maxCell = (bounds.max - origin) / cellSize;
+    if (maxCell.x < 0 || maxCell.y < 0 || minCell.x >= columns || minCell.y >= rows)
+    {
+        return;
+    }
+
+    int32_t minColumn = std::max(static_cast<int32_t>(minCell.x), 0);
+    int32_t maxColumn = std::min(static_cast<int32_t>(maxCell.x), columns - 1);
+    int32_t minRow = std::max(static_cast<int32_t>(minCell.y), 0);
+    int32_t maxRow = std::min(static_cast<int32_t>(maxCell.y), rows - 1);
+    for (int32_t row = minRow; row <= maxRow; ++row)
+    {
+        for (int32_t column = minColumn; column <= maxColumn; ++column)
+        {
+            int32_t cell = row * columns + column;
+            results.insert(results.end(), cellItems.begin() + cellStarts[cell], cellItems.begin() + cellStarts[cell + 1]);
+        }
+    }
+}
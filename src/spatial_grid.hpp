@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct Bounds
+{
+    glm::vec2 min;
+    glm::vec2 max;
+
+    bool overlaps(const Bounds& other) const
+    {
+        return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y;
+    }
+};
+
+struct SpatialGridItem
+{
+    uint32_t index;
+    Bounds bounds;
+};
+
+// uniform grid over a fixed set of items, stored as one packed item list per cell.
+// items spanning several cells are listed in each of them, so query results can contain duplicates
+class SpatialGrid
+{
+    float baseCellSize;
+    float cellSize;
+    glm::vec2 origin = glm::vec2(0.0f);
+    int32_t columns = 0;
+    int32_t rows = 0;
+    std::vector<uint32_t> cellStarts;
+    std::vector<uint32_t> cellItems;
+    size_t itemCount = 0;
+
+public:
+    explicit SpatialGrid(float baseCellSize);
+
+    void build(const std::vector<SpatialGridItem>& items);
+    void query(const Bounds& bounds, std::vector<uint32_t>& results) const;
+
+    size_t size() const { return itemCount; }
+};
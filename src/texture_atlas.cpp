@@ -0,0 +1,212 @@
+#include "texture_atlas.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#include "opengl_utils.hpp"
+
+// padding is filled by extruding each image's edge pixels. mip levels are capped so that
+// a level never samples further than the padding reaches. that only holds if each image starts
+// on a texel boundary of the last level, so origins are aligned to its texel size
+static constexpr int ATLAS_PADDING = 4;
+static constexpr int ATLAS_MAX_MIP_LEVEL = 2;
+static constexpr int ATLAS_ALIGNMENT = 1 << ATLAS_MAX_MIP_LEVEL;
+static_assert(ATLAS_PADDING >= ATLAS_ALIGNMENT, "a last level texel next to an image must lie inside its padding");
+
+static int nextPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result < value)
+    {
+        result *= 2;
+    }
+    return result;
+}
+
+static int alignUp(int value, int alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool packShelves(std::vector<AtlasRect>& rects, const std::vector<uint32_t>& order, int padding, int alignment, int pageWidth, int pageHeight)
+{
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+    for (auto i : order)
+    {
+        auto& rect = rects[i];
+        int left = alignUp(x + padding, alignment);
+        if (left + rect.width + padding > pageWidth)
+        {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+            left = alignUp(padding, alignment);
+            if (left + rect.width + padding > pageWidth)
+            {
+                return false;
+            }
+        }
+        int top = alignUp(y + padding, alignment);
+        if (top + rect.height + padding > pageHeight)
+        {
+            return false;
+        }
+        rect.x = left;
+        rect.y = top;
+        x = left + rect.width + padding;
+        shelfHeight = std::max(shelfHeight, top + rect.height + padding - y);
+    }
+    return true;
+}
+
+// copies source into destination at (x, y), repeating its edge pixels outward by the given margins
+static void blitExtruded(Image& destination, int x, int y, const Image& source, int left, int top, int right, int bottom)
+{
+    for (int sourceY = -top; sourceY < source.height + bottom; ++sourceY)
+    {
+        int clampedY = std::clamp(sourceY, 0, source.height - 1);
+        for (int sourceX = -left; sourceX < source.width + right; ++sourceX)
+        {
+            int clampedX = std::clamp(sourceX, 0, source.width - 1);
+            std::memcpy(&destination.pixels[4 * ((y + sourceY) * destination.width + x + sourceX)], &source.pixels[4 * (clampedY * source.width + clampedX)], 4);
+        }
+    }
+}
+
+bool packAtlas(std::vector<AtlasRect>& rects, int padding, int alignment, int maxSize, int& pageWidth, int& pageHeight)
+{
+    // tallest first keeps shelves tight
+    std::vector<uint32_t> order(rects.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&] (auto i0, auto i1) { return rects[i0].height > rects[i1].height; });
+
+    int64_t area = 0;
+    for (const auto& rect : rects)
+    {
+        area += static_cast<int64_t>(rect.width + 2 * padding) * (rect.height + 2 * padding);
+    }
+
+    pageWidth = nextPowerOfTwo(static_cast<int>(std::ceil(std::sqrt(static_cast<double>(area)))));
+    pageHeight = pageWidth / 2 > 0 ? pageWidth / 2 : 1;
+    while (pageWidth <= maxSize && pageHeight <= maxSize)
+    {
+        if (packShelves(rects, order, padding, alignment, pageWidth, pageHeight))
+        {
+            return true;
+        }
+
+        // grow the short side first so the page stays close to square
+        if (pageHeight < pageWidth)
+        {
+            pageHeight *= 2;
+        }
+        else
+        {
+            pageWidth *= 2;
+        }
+    }
+    return false;
+}
+
+GLuint buildTextureAtlas(const std::vector<const Image*>& images, std::vector<TextureRegion>& regions, PixelUploadBuffer* staging)
+{
+    std::vector<AtlasRect> rects(images.size());
+    for (uint32_t i = 0; i < images.size(); ++i)
+    {
+        rects[i].width = images[i]->width;
+        rects[i].height = images[i]->height;
+    }
+
+    GLint maxTextureSize;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    Image page;
+    if (!packAtlas(rects, ATLAS_PADDING, ATLAS_ALIGNMENT, maxTextureSize, page.width, page.height))
+    {
+        throw std::runtime_error("Images don't fit in a single atlas page");
+    }
+
+    page.pixels.assign(4 * page.width * page.height, 0);
+    for (uint32_t i = 0; i < images.size(); ++i)
+    {
+        blitExtruded(page, rects[i].x, rects[i].y, *images[i], ATLAS_PADDING, ATLAS_PADDING, ATLAS_PADDING, ATLAS_PADDING);
+    }
+
+    GLuint texture = createTexture(page, staging);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ATLAS_MAX_MIP_LEVEL);
+
+    regions.resize(images.size());
+    for (uint32_t i = 0; i < images.size(); ++i)
+    {
+        regions[i].texture = texture;
+        regions[i].texRect = {
+            static_cast<float>(rects[i].x) / page.width, static_cast<float>(rects[i].y) / page.height,
+            static_cast<float>(rects[i].width) / page.width, static_cast<float>(rects[i].height) / page.height };
+    }
+
+    return texture;
+}
+
+void buildTextureArrays(const std::vector<const Image*>& images, std::vector<TextureRegion>& regions, std::vector<GLuint>& textures,
+    PixelUploadBuffer* staging)
+{
+    regions.resize(images.size());
+    std::vector<bool> assigned(images.size(), false);
+    for (uint32_t i = 0; i < images.size(); ++i)
+    {
+        if (assigned[i])
+        {
+            continue;
+        }
+
+        int width = images[i]->width;
+        int height = images[i]->height;
+        std::vector<uint32_t> group;
+        for (uint32_t j = i; j < images.size(); ++j)
+        {
+            if (!assigned[j] && images[j]->width == width && images[j]->height == height)
+            {
+                group.push_back(j);
+                assigned[j] = true;
+            }
+        }
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, group.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        // each image fills its layer, so texRect scales above 1 repeat it
+        for (uint32_t layerIndex = 0; layerIndex < group.size(); ++layerIndex)
+        {
+            const auto& image = *images[group[layerIndex]];
+            const void* pixels = image.pixels.data();
+            if (staging)
+            {
+                staging->stage(pixels, image.pixels.size());
+                pixels = nullptr;
+            }
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layerIndex, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+            auto& region = regions[group[layerIndex]];
+            region.texture = texture;
+            region.texRect = { 0.0f, 0.0f, 1.0f, 1.0f };
+            region.layer = layerIndex;
+        }
+        if (staging)
+        {
+            PixelUploadBuffer::unbind();
+        }
+
+        generateMipmaps(GL_TEXTURE_2D_ARRAY, texture, staging);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        textures.push_back(texture);
+    }
+}
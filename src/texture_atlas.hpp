@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+struct Image;
+class PixelUploadBuffer;
+
+// a whole texture, or a rectangle of one such as an atlas page
+struct TextureRegion
+{
+    GLuint texture = 0;
+    glm::vec4 texRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); // xy: offset, zw: scale, in normalized texture coordinates
+    int32_t layer = -1; // layer of a GL_TEXTURE_2D_ARRAY, or -1 for a plain 2D texture
+};
+
+struct AtlasRect
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// shelf-packs the rects (width and height in, x and y out) into the smallest power-of-two page that fits them,
+// leaving padding pixels around each one and starting each at a multiple of alignment. returns false if the
+// page would have to be larger than maxSize
+bool packAtlas(std::vector<AtlasRect>& rects, int padding, int alignment, int maxSize, int& pageWidth, int& pageHeight);
+
+// packs the images into a single texture. regions[i] covers images[i]. staging is optional, see PixelUploadBuffer
+GLuint buildTextureAtlas(const std::vector<const Image*>& images, std::vector<TextureRegion>& regions, PixelUploadBuffer* staging = nullptr);
+
+// alternative to the atlas for images that shouldn't share a page: images of the same size become the layers
+// of one GL_TEXTURE_2D_ARRAY. each image fills its whole layer, so a texRect scale above 1 repeats it, which
+// the atlas can't do. new array textures are appended to textures, and regions[i] covers images[i]
+void buildTextureArrays(const std::vector<const Image*>& images, std::vector<TextureRegion>& regions, std::vector<GLuint>& textures,
+    PixelUploadBuffer* staging = nullptr);
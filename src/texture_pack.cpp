@@ -0,0 +1,152 @@
+#include "texture_pack.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static std::string getBaseName(const std::string& filename)
+{
+    auto separator = filename.find_last_of("/\\");
+    return separator == std::string::npos ? filename : filename.substr(separator + 1);
+}
+
+TexturePack::TexturePack(const char* filename)
+{
+    // the mapping outlives the file handles, so they're closed right away
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Failed to open texture pack: " + std::string(filename));
+    }
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+    {
+        size = static_cast<size_t>(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    CloseHandle(file);
+    if (mapping)
+    {
+        data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+    }
+#else
+    int file = open(filename, O_RDONLY);
+    if (file < 0)
+    {
+        throw std::runtime_error("Failed to open texture pack: " + std::string(filename));
+    }
+    struct stat fileStatus;
+    if (fstat(file, &fileStatus) == 0 && fileStatus.st_size > 0)
+    {
+        size = static_cast<size_t>(fileStatus.st_size);
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        data = mapping != MAP_FAILED ? static_cast<const uint8_t*>(mapping) : nullptr;
+    }
+    close(file);
+#endif
+    if (!data)
+    {
+        throw std::runtime_error("Failed to map texture pack: " + std::string(filename));
+    }
+
+    // everything is checked once here so lookups can trust the index
+    const auto* header = reinterpret_cast<const TexturePackHeader*>(data);
+    if (size < sizeof(TexturePackHeader) || std::memcmp(header->magic, TEXTURE_PACK_MAGIC, sizeof(header->magic)) != 0
+            || header->version != TEXTURE_PACK_VERSION || size < sizeof(TexturePackHeader) + header->entryCount * sizeof(TexturePackEntry))
+    {
+        unmap();
+        throw std::runtime_error("Invalid texture pack: " + std::string(filename));
+    }
+    for (uint32_t i = 0; i < header->entryCount; ++i)
+    {
+        const auto& entry = getEntry(i);
+        uint64_t expectedSize = 0;
+        for (uint32_t level = 0; level < entry.levelCount; ++level)
+        {
+            expectedSize += 4ull * getMipSize(entry.width, level) * getMipSize(entry.height, level);
+        }
+        if (entry.name[TEXTURE_PACK_NAME_SIZE - 1] != '\0' || entry.levelCount == 0 || entry.size != expectedSize
+                || entry.offset > size || entry.size > size - entry.offset)
+        {
+            unmap();
+            throw std::runtime_error("Invalid texture pack entry in: " + std::string(filename));
+        }
+    }
+}
+
+TexturePack::~TexturePack()
+{
+    unmap();
+}
+
+void TexturePack::unmap()
+{
+    if (!data)
+    {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<uint8_t*>(data), size);
+#endif
+    data = nullptr;
+}
+
+uint32_t TexturePack::getEntryCount() const
+{
+    return reinterpret_cast<const TexturePackHeader*>(data)->entryCount;
+}
+
+const TexturePackEntry& TexturePack::getEntry(uint32_t index) const
+{
+    return reinterpret_cast<const TexturePackEntry*>(data + sizeof(TexturePackHeader))[index];
+}
+
+const TexturePackEntry& TexturePack::find(const std::string& filename) const
+{
+    // a handful of entries, a linear scan is plenty
+    std::string name = getBaseName(filename);
+    for (uint32_t i = 0; i < getEntryCount(); ++i)
+    {
+        if (name == getEntry(i).name)
+        {
+            return getEntry(i);
+        }
+    }
+    throw std::runtime_error("Texture pack has no image: " + filename);
+}
+
+const uint8_t* TexturePack::getPixels(const TexturePackEntry& entry, uint32_t level) const
+{
+    const uint8_t* pixels = data + entry.offset;
+    for (uint32_t i = 0; i < level; ++i)
+    {
+        pixels += 4 * getMipSize(entry.width, i) * getMipSize(entry.height, i);
+    }
+    return pixels;
+}
+
+Image TexturePack::getImage(const std::string& filename) const
+{
+    const auto& entry = find(filename);
+    Image image;
+    image.width = entry.width;
+    image.height = entry.height;
+    const uint8_t* pixels = getPixels(entry, 0);
+    image.pixels.assign(pixels, pixels + 4 * entry.width * entry.height);
+    return image;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "image_loader.hpp"
+
+// textures.pack holds decoded images so startup can skip png decoding entirely. the file is a header, an entry per
+// image, then pixel data. each image has its full mip chain, every level tightly packed RGBA8 with rows top to
+// bottom, halving down to 1x1. offsets are from the start of the file. written by tools/texture_packer
+static constexpr char TEXTURE_PACK_MAGIC[8] = { 'L', 'D', '5', '3', 'T', 'E', 'X', 'P' };
+static constexpr uint32_t TEXTURE_PACK_VERSION = 1;
+static constexpr size_t TEXTURE_PACK_NAME_SIZE = 64;
+
+struct TexturePackHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+};
+
+struct TexturePackEntry
+{
+    char name[TEXTURE_PACK_NAME_SIZE]; // file name without its directory, null terminated
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t reserved;
+    uint64_t offset; // level 0, the other levels follow it in order
+    uint64_t size; // all levels
+};
+
+inline int getMipSize(int size, uint32_t level)
+{
+    return std::max(size >> level, 1);
+}
+
+// a memory mapped texture pack. pixel pointers point into the mapping, so they are valid as long as the pack is
+class TexturePack
+{
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    void unmap();
+
+public:
+    explicit TexturePack(const char* filename);
+    ~TexturePack();
+
+    TexturePack(const TexturePack&) = delete;
+    TexturePack& operator=(const TexturePack&) = delete;
+
+    uint32_t getEntryCount() const;
+    const TexturePackEntry& getEntry(uint32_t index) const;
+
+    // looks up by file name, ignoring any directory. throws if the image isn't in the pack
+    const TexturePackEntry& find(const std::string& filename) const;
+    const uint8_t* getPixels(const TexturePackEntry& entry, uint32_t level) const;
+
+    // a copy of level 0, for building atlases and tilesets
+    Image getImage(const std::string& filename) const;
+};
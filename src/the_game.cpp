@@ -2,8 +2,12 @@
 #include "the_game.hpp"
 
 #include <algorithm>
+#include <cstdlib>
+#include <filesystem>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <GLFW/glfw3.h>
@@ -15,6 +19,7 @@
 #include "opengl_utils.hpp"
 
 #define PIXELS_PER_WORLD_UNIT 32
+#define TEXTURE_PACK_FILENAME "textures/textures.pack"
 
 static void updateVelocity(Dynamic& body, const glm::vec2& targetVelocity, float acceleration, float dt)
 {
@@ -113,7 +118,7 @@ Game* createGame()
 }
 
 TheGame::TheGame() :
-    renderer(sceneGraph, drawInstances, textInstances),
+    renderer(renderBackend, sceneGraph, drawInstances, textInstances, tilemaps),
     physicsWorld(sceneGraph, colliders, dynamics),
     cameraPosition(0, 0),
     cameraViewHeight(20.0f),
@@ -125,9 +130,15 @@ TheGame::TheGame() :
     audio = newAudio();
     initAudio(audio);
 
-    bonkSound = newSound("audio/bonk.ogg", false);
+    // decoded while the textures load, picked up once they are in
+    audioAssets.request("audio/bonk.ogg", false);
+    if (std::getenv("LD53_MUSIC"))
+    {
+        music = newSoundStream(std::getenv("LD53_MUSIC"), true);
+    }
 
     startAudioStream(audio);
+    audioPlayStream(audio, music, 1.0f);
 
     entityManager.addComponentManager(sceneGraph);
     entityManager.addComponentManager(arrows);
@@ -156,15 +167,130 @@ TheGame::TheGame() :
     entityManager.addComponentManager(uiElements);
     entityManager.addComponentManager(weapons);
 
-    auto characterTexture = textures.emplace_back(loadTexture("textures/character.png"));
-    auto armTexture = textures.emplace_back(loadTexture("textures/arm.png"));
-    auto houseTexture = textures.emplace_back(loadTexture("textures/house.png"));
-    auto intersectionTexture = textures.emplace_back(loadTexture("textures/intersection.png"));
-    auto roadHorizontalTexture = textures.emplace_back(loadTexture("textures/road_horizontal.png"));
-    auto roadVerticalTexture = textures.emplace_back(loadTexture("textures/road_vertical.png"));
-    auto depotTexture = textures.emplace_back(loadTexture("textures/depot.png"));
-    arrowTexture = textures.emplace_back(loadTexture("textures/arrow.png"));
-    closeButtonTexture = textures.emplace_back(loadTexture("textures/close_button.png"));
+    const char* const textureFilenames[] = {
+        "textures/character.png",
+        "textures/arm.png",
+        "textures/house.png",
+        "textures/depot.png",
+        "textures/arrow.png",
+        "textures/close_button.png",
+        "textures/font.png",
+    };
+    // roads are cut into one unit tiles for the tilemap. every road edge in the city falls on a whole unit
+    const char* const roadFilenames[] = {
+        "textures/intersection.png",
+        "textures/road_horizontal.png",
+        "textures/road_vertical.png",
+    };
+
+    // textures.pack, built from the pngs by tools/texture_packer, is memory mapped so nothing needs decoding.
+    // without it every png is queued up front and decoded in parallel, while this thread builds textures
+    // from the ones already done
+    std::optional<TexturePack> texturePack;
+    std::optional<ImageLoader> imageLoader;
+    std::vector<uint32_t> imageTickets;
+    std::vector<uint32_t> roadImageTickets;
+    if (std::filesystem::exists(TEXTURE_PACK_FILENAME))
+    {
+        texturePack.emplace(TEXTURE_PACK_FILENAME);
+    }
+    else
+    {
+        imageLoader.emplace();
+        for (auto filename : textureFilenames)
+        {
+            imageTickets.push_back(imageLoader->request(filename));
+        }
+        for (auto filename : roadFilenames)
+        {
+            roadImageTickets.push_back(imageLoader->request(filename));
+        }
+    }
+    auto getImage = [&](const char* filename, const std::vector<uint32_t>& tickets, uint32_t index)
+    {
+        return texturePack ? texturePack->getImage(filename) : imageLoader->wait(tickets[index]);
+    };
+
+    // everything shares one atlas page by default so sprites batch regardless of source image.
+    // LD53_TEXTURE_BATCHING=array groups images into texture arrays instead, and =none loads
+    // separate textures, for comparison
+    std::vector<TextureRegion> regions;
+    const std::string textureBatching = std::getenv("LD53_TEXTURE_BATCHING") ? std::getenv("LD53_TEXTURE_BATCHING") : "";
+    std::vector<Image> images;
+    std::vector<const Image*> imagePointers;
+    // every texture below is staged through here, and mipmaps wait until they have all been issued
+    PixelUploadBuffer uploadBuffer;
+    if (textureBatching == "none")
+    {
+        for (uint32_t i = 0; i < std::size(textureFilenames); ++i)
+        {
+            GLuint texture = texturePack ? createTexture(*texturePack, texturePack->find(textureFilenames[i]))
+                : createTexture(imageLoader->wait(imageTickets[i]), &uploadBuffer);
+            regions.emplace_back().texture = textures.emplace_back(texture);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < std::size(textureFilenames); ++i)
+        {
+            images.push_back(getImage(textureFilenames[i], imageTickets, i));
+        }
+        for (const auto& image : images)
+        {
+            imagePointers.push_back(&image);
+        }
+    }
+
+    if (textureBatching == "array")
+    {
+        // text is drawn with a plain sampler2D, so the font gets a texture of its own
+        const Image* fontImage = imagePointers.back();
+        imagePointers.pop_back();
+        buildTextureArrays(imagePointers, regions, textures, &uploadBuffer);
+        regions.emplace_back().texture = textures.emplace_back(createTexture(*fontImage, &uploadBuffer));
+    }
+    else if (textureBatching != "none")
+    {
+        textures.push_back(buildTextureAtlas(imagePointers, regions, &uploadBuffer));
+    }
+    // the font is always the last image, so the backend never decodes one of its own
+    renderer.setFont(regions.back());
+    // LD53_RENDER_STATS logs a summary every second, LD53_RENDER_OVERLAY draws one on screen,
+    // and LD53_RENDER_STATS_FILE writes every frame's stats to a csv file
+    logRenderStats = std::getenv("LD53_RENDER_STATS") != nullptr;
+    showRenderStatsOverlay = std::getenv("LD53_RENDER_OVERLAY") != nullptr;
+    if (std::getenv("LD53_RENDER_STATS_FILE"))
+    {
+        renderStatsFile.open(std::getenv("LD53_RENDER_STATS_FILE"));
+        if (!renderStatsFile)
+        {
+            throw std::runtime_error("Failed to open file: " + std::string(std::getenv("LD53_RENDER_STATS_FILE")));
+        }
+        writeStatsHeader(renderStatsFile);
+    }
+
+    auto characterTexture = regions[0];
+    auto armTexture = regions[1];
+    auto houseTexture = regions[2];
+    auto depotTexture = regions[3];
+    arrowTexture = regions[4];
+    closeButtonTexture = regions[5];
+
+    std::vector<Image> roadImages;
+    std::vector<const Image*> roadImagePointers;
+    for (uint32_t i = 0; i < std::size(roadFilenames); ++i)
+    {
+        roadImages.push_back(getImage(roadFilenames[i], roadImageTickets, i));
+    }
+    for (const auto& image : roadImages)
+    {
+        roadImagePointers.push_back(&image);
+    }
+    std::vector<std::vector<uint16_t>> roadTiles;
+    GLuint roadTileset = textures.emplace_back(buildTileset(roadImagePointers, PIXELS_PER_WORLD_UNIT, roadTiles, &uploadBuffer));
+    uploadBuffer.finishUploads();
+
+    bonkSound = audioAssets.get("audio/bonk.ogg");
 
     playerBodyDescription  = {};
     playerBodyDescription.color = { 1.0, 1.0, 1.0, 1.0 };
@@ -202,7 +328,7 @@ TheGame::TheGame() :
     weaponDescription.damage = 2.0f;
     weaponDescription.size = { 0.1f, 0.5f };
     weaponDescription.color = { 0.8, 0.8, 0.8, 1.0 };
-    weaponDescription.texture = 0;
+    weaponDescription.texture = {};
 
     zombieWeaponAnimation = {};
     zombieWeaponAnimation.poseAngles = { -M_PI_2, -M_PI_2 - M_PI_4, -M_PI_2 - M_PI_4, -M_PI_2 + M_PI_4, -M_PI_2 };
@@ -215,15 +341,29 @@ TheGame::TheGame() :
     zombieWeaponDescription.damage = 0.8f;
     zombieWeaponDescription.size = { 0.15f, 0.15f };
 
-    // build city
+    // build city. roads are one tilemap, drawn under everything else
+    auto roadTilemapIndex = entityManager.create();
+    tilemaps.create(roadTilemapIndex);
+    auto& roadTilemap = tilemaps.get(roadTilemapIndex);
+    roadTilemap.origin = { -6.0f, -4.5f };
+    roadTilemap.tileSize = 1.0f;
+    roadTilemap.tileset = roadTileset;
+    roadTilemap.resize(4 * 60, 4 * 15);
+    auto stampRoad = [&](const glm::vec2& position, const glm::vec2& size, const std::vector<uint16_t>& tiles)
+    {
+        glm::ivec2 cell(glm::round((position - 0.5f * size - roadTilemap.origin) / roadTilemap.tileSize));
+        glm::ivec2 cells(glm::round(size / roadTilemap.tileSize));
+        roadTilemap.stamp(cell.x, cell.y, cells.x, cells.y, tiles);
+    };
+
     for (int i = 0; i < 4; ++i)
     {
         for (int j = 0; j < 4; ++j)
         {
             glm::vec2 offset{ (12 + 12 * 4) * i, 15 * j };
-            createSprite(0, offset, { 12, 9 }, { 1, 1, 1, 1 }, intersectionTexture, false, -9);
-            createSprite(0, { offset.x, offset.y + 6 }, { 6, 3 }, { 1, 1, 1, 1 }, roadVerticalTexture, false, -3);
-            createSprite(0, { offset.x, offset.y + 9 }, { 6, 3 }, { 1, 1, 1, 1 }, roadVerticalTexture, false, -3);
+            stampRoad(offset, { 12, 9 }, roadTiles[0]);
+            stampRoad({ offset.x, offset.y + 6 }, { 6, 3 }, roadTiles[2]);
+            stampRoad({ offset.x, offset.y + 9 }, { 6, 3 }, roadTiles[2]);
 
             for (int k = 0; k < 4; ++k)
             {
@@ -236,13 +376,15 @@ TheGame::TheGame() :
                 auto& collider = colliders.get(index);
                 collider.halfExtents = { 5.0, 3.25 };
                 dynamics.create(index);
-                createSprite(index, { 0, 1.25 }, { 12, 11 }, { 1.0, 1.0, 1.0, 1.0 }, houseTexture, false);
+                createSprite(index, { 0, 1.25 }, { 12, 11 }, { 1.0, 1.0, 1.0, 1.0 }, houseTexture, false, 0, true);
+                // each house sits on a lawn reaching from its road to the next row's. flat ground, so it is baked rather than sorted
+                createSprite(index, { 0, 0.25 }, { 12, 10 }, { 0.15, 0.42, 0.12, 1.0 }, {}, false, 0, false, true);
                 auto address = createTrigger(index, { -0.5, -3.75 }, { 1, 1 }, GLFW_KEY_E, deliveryAddressTriggerCallback, deliveryAddressTriggerCondition);
                 addresses.create(address);
 
-                createSprite(0, { offset.x - 4, offset.y }, { 4, 5 }, { 1, 1, 1, 1 }, roadHorizontalTexture, false, -5);
-                createSprite(0, { offset.x, offset.y }, { 4, 5 }, { 1, 1, 1, 1 }, roadHorizontalTexture, false, -5);
-                createSprite(0, { offset.x + 4, offset.y }, { 4, 5 }, { 1, 1, 1, 1 }, roadHorizontalTexture, false, -5);
+                stampRoad({ offset.x - 4, offset.y }, { 4, 5 }, roadTiles[1]);
+                stampRoad({ offset.x, offset.y }, { 4, 5 }, roadTiles[1]);
+                stampRoad({ offset.x + 4, offset.y }, { 4, 5 }, roadTiles[1]);
             }
         }
     }
@@ -254,7 +396,9 @@ TheGame::TheGame() :
     colliders.create(depotBuilding);
     colliders.get(depotBuilding).halfExtents = { 7, 4 };
     dynamics.create(depotBuilding);
-    createSprite(depotBuilding, { 0, 1 }, { 16, 12 }, { 1, 1, 1, 1 }, depotTexture);
+    createSprite(depotBuilding, { 0, 1 }, { 16, 12 }, { 1, 1, 1, 1 }, depotTexture, false, 0, true);
+    // paved yard around the depot, baked like the lawns
+    createSprite(depotBuilding, { 0, -0.5 }, { 18, 12 }, { 0.42, 0.4, 0.36, 1.0 }, {}, false, 0, false, true);
     auto depotTrigger = createTrigger(depotBuilding, { 5, -4.5 }, { 2, 1 }, GLFW_KEY_E, depotOverlayTriggerCallback);
     depots.create(depotTrigger);
 
@@ -271,6 +415,8 @@ TheGame::~TheGame()
     stopAudioStream(audio);
     cleanupAudio(audio);
     freeAudio(audio);
+    freeSound(bonkSound);
+    freeSoundStream(music);
 }
 
 void TheGame::updateTemporaries(float dt)
@@ -372,15 +518,13 @@ void TheGame::update(GLFWwindow* window)
     }
     gameTime += dt;
 
-    /* if (timerValue - fpsTimer >= glfwGetTimerFrequency())
+    if (timerValue - fpsTimer >= glfwGetTimerFrequency())
     {
-        double fps = static_cast<double>(frames * glfwGetTimerFrequency()) / static_cast<double>(timerValue - fpsTimer);
-        std::string windowTitle = "FPS: " + std::to_string(static_cast<int>(fps + 0.5));
-        glfwSetWindowTitle(window, windowTitle.c_str());
+        fps = static_cast<double>(frames * glfwGetTimerFrequency()) / static_cast<double>(timerValue - fpsTimer);
         frames = 0;
         fpsTimer = timerValue;
     }
-    ++frames; */
+    ++frames;
 
     glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
     glm::mat4 pixelOrtho = glm::ortho<float>(0, windowWidth, 0, windowHeight);
@@ -486,6 +630,7 @@ void TheGame::update(GLFWwindow* window)
     // updateStoreOverlay();
     updateStoreOverlayItems();
     updatePauseOverlay();
+    updateRenderStatsOverlay();
     updateUI();
     updateTemporaries(dt);
 
@@ -494,8 +639,62 @@ void TheGame::update(GLFWwindow* window)
 
 void TheGame::draw()
 {
-    renderer.prepareRender({ cameraMatrix, uiCameraMatrix });
-    renderer.render(windowWidth, windowHeight, { 0.1, 0.5, 0.1, 1.0} );
+    const RenderSnapshot& frame = renderSnapshot;
+    const glm::mat4& sceneCamera = pipelined ? frame.cameraMatrix : cameraMatrix;
+    const glm::mat4& uiCamera = pipelined ? frame.uiCameraMatrix : uiCameraMatrix;
+    int width = pipelined ? frame.windowWidth : windowWidth;
+    int height = pipelined ? frame.windowHeight : windowHeight;
+    uint64_t frameTimerValue = pipelined ? frame.timerValue : timerValue;
+
+    renderer.prepareRender({ sceneCamera, uiCamera }, static_cast<float>(pipelined ? frame.gameTime : gameTime));
+    renderer.render(width, height, { 0.1, 0.5, 0.1, 1.0} );
+
+    const auto& stats = renderer.getStats();
+    if (!pipelined)
+    {
+        lastRenderStats = stats;
+    }
+    if (renderStatsFile.is_open())
+    {
+        writeStats(renderStatsFile, stats);
+    }
+    if (logRenderStats && frameTimerValue - renderStatsTimer >= glfwGetTimerFrequency())
+    {
+        std::cout << "instances: " << stats.instances << " (" << stats.culledInstances << " culled), batches: " << stats.batches
+            << ", draw calls: " << stats.drawCalls << ", state changes: " << stats.stateChanges << ", uploaded: " << stats.uploadedBytes
+            << " bytes, prepare: " << stats.prepareMilliseconds << " ms, render: " << stats.renderMilliseconds << " ms" << std::endl;
+        renderStatsTimer = frameTimerValue;
+    }
+}
+
+void TheGame::setPipelined(bool pipelined)
+{
+    this->pipelined = pipelined;
+    if (pipelined)
+    {
+        snapshot();
+        renderer.setScene(renderSnapshot.sceneGraph, renderSnapshot.drawInstances, renderSnapshot.textInstances, renderSnapshot.tilemaps);
+    }
+    else
+    {
+        renderer.setScene(sceneGraph, drawInstances, textInstances, tilemaps);
+    }
+}
+
+void TheGame::snapshot()
+{
+    // copy assignment reuses the snapshot's storage, so this stops allocating once the scene stops growing
+    renderSnapshot.sceneGraph = sceneGraph;
+    renderSnapshot.drawInstances = drawInstances;
+    renderSnapshot.textInstances = textInstances;
+    renderSnapshot.tilemaps = tilemaps;
+    renderSnapshot.cameraMatrix = cameraMatrix;
+    renderSnapshot.uiCameraMatrix = uiCameraMatrix;
+    renderSnapshot.windowWidth = windowWidth;
+    renderSnapshot.windowHeight = windowHeight;
+    renderSnapshot.timerValue = timerValue;
+    renderSnapshot.gameTime = gameTime;
+    lastRenderStats = renderer.getStats();
 }
 
 void TheGame::setCharacterFlipHorizontal(uint32_t index, bool flipHorizontal)
@@ -553,7 +752,7 @@ void TheGame::addHealthComponent(uint32_t index, float maxHealth, GenericCallbac
     instance.size = { 1.0, 0.1f };
 }
 
-uint32_t TheGame::createSprite(uint32_t parent, const glm::vec2& position, const glm::vec2& size, const glm::vec4& color, GLuint texture, bool flipHorizontal, float heightForDepth)
+uint32_t TheGame::createSprite(uint32_t parent, const glm::vec2& position, const glm::vec2& size, const glm::vec4& color, const TextureRegion& texture, bool flipHorizontal, float heightForDepth, bool isStatic, bool isBaked)
 {
     auto index = entityManager.create();
     sceneGraph.create(index, parent);
@@ -563,8 +762,16 @@ uint32_t TheGame::createSprite(uint32_t parent, const glm::vec2& position, const
     auto& instance = drawInstances.get(index);
     instance.color = color;
     instance.size = size;
-    instance.texture = texture;
+    instance.texture = texture.texture;
+    instance.texRect = texture.texRect;
+    instance.textureLayer = texture.layer;
     instance.flipHorizontal = flipHorizontal;
+    instance.isStatic = isStatic;
+    instance.isBaked = isBaked;
+    if (isStatic || isBaked)
+    {
+        drawInstances.invalidateStatic();
+    }
     return index;
 }
 
@@ -599,7 +806,9 @@ uint32_t TheGame::createWeapon(uint32_t owner, const WeaponDescription& descript
     auto& instance = drawInstances.get(index);
     instance.color = description.color;
     instance.size = description.size;
-    instance.texture = description.texture;
+    instance.texture = description.texture.texture;
+    instance.texRect = description.texture.texRect;
+    instance.textureLayer = description.texture.layer;
     sceneGraph.create(index, character.frontHand);
     sceneGraph.setPosition(index, { 0, 0.5f * description.size.y });
     colliders.create(index);
@@ -717,7 +926,7 @@ uint32_t TheGame::createZombie(const glm::vec2& position)
     return index;
 }
 
-uint32_t TheGame::createOverlay(const glm::vec2& position, const glm::vec2& size, GLuint texture, bool closeButton)
+uint32_t TheGame::createOverlay(const glm::vec2& position, const glm::vec2& size, const TextureRegion& texture, bool closeButton)
 {
     auto index = entityManager.create();
     sceneGraph.create(index);
@@ -727,7 +936,9 @@ uint32_t TheGame::createOverlay(const glm::vec2& position, const glm::vec2& size
     auto& instance = drawInstances.get(index);
     instance.layer = 1;
     instance.size = size;
-    instance.texture = texture;
+    instance.texture = texture.texture;
+    instance.texRect = texture.texRect;
+    instance.textureLayer = texture.layer;
 
     uiElements.create(index);
 
@@ -740,7 +951,9 @@ uint32_t TheGame::createOverlay(const glm::vec2& position, const glm::vec2& size
         auto& instance = drawInstances.get(closeButtonIndex);
         instance.size = { 0.5f, 0.5f };
         instance.layer = 1;
-        instance.texture = closeButtonTexture;
+        instance.texture = closeButtonTexture.texture;
+        instance.texRect = closeButtonTexture.texRect;
+        instance.textureLayer = closeButtonTexture.layer;
         uiElements.create(closeButtonIndex);
         auto& element = uiElements.get(closeButtonIndex);
         element.anchor = UIElement::Position::UpperRight;
@@ -869,7 +1082,9 @@ void TheGame::updatePlayer(GLFWwindow* window, const glm::vec2& cursorScenePosit
                 arrow.target = player.target;
                 drawInstances.create(player.arrow);
                 auto& instance = drawInstances.get(player.arrow);
-                instance.texture = arrowTexture;
+                instance.texture = arrowTexture.texture;
+                instance.texRect = arrowTexture.texRect;
+                instance.textureLayer = arrowTexture.layer;
                 instance.size = { 1, 0.5 };
                 instance.layer = 1;
                 uiElements.create(player.arrow);
@@ -1210,7 +1425,7 @@ void TheGame::updatePauseOverlay()
             return;
         }
 
-        pauseOverlay = createOverlay({ 0, 0 }, { 8, 5 }, 0, false);
+        pauseOverlay = createOverlay({ 0, 0 }, { 8, 5 }, {}, false);
         createText(pauseOverlay, "PAUSED", { 0, -0.25f }, { 0.5, 1.0 }, { 0, 0, 0, 1 }, UIElement::Position::Top, UIElement::Position::Top);
         createText(pauseOverlay, std::string(glfwGetKeyName(GLFW_KEY_P, 0)) + " to unpause", { 0, -2 }, { 0.25f, 0.5f }, { 0, 0, 0, 1 }, UIElement::Position::Top, UIElement::Position::Top);
         createText(pauseOverlay, "Esc to quit", { 0, -3 }, { 0.25f, 0.5f }, { 0, 0, 0, 1 }, UIElement::Position::Top, UIElement::Position::Top);
@@ -1332,6 +1547,36 @@ void TheGame::updateZombieLevel(float dt)
     textInstances.get(zombieLevelText).text = zombieLevelTextStream.str();
 }
 
+void TheGame::updateRenderStatsOverlay()
+{
+    if (!showRenderStatsOverlay)
+    {
+        return;
+    }
+
+    // stats are from the last frame drawn, which is the one before this when pipelined
+    const auto& stats = lastRenderStats;
+    std::stringstream lines[4];
+    for (auto& line : lines)
+    {
+        line << std::fixed << std::setprecision(2);
+    }
+    lines[0] << "FPS: " << std::setprecision(0) << fps;
+    lines[1] << "Prepare: " << stats.prepareMilliseconds << " ms, render: " << stats.renderMilliseconds << " ms";
+    lines[2] << "Instances: " << stats.instances << ", visible: " << stats.visibleInstances << ", culled: " << stats.culledInstances;
+    lines[3] << "Batches: " << stats.batches << ", draws: " << stats.drawCalls << ", states: " << stats.stateChanges
+        << ", upload: " << stats.uploadedBytes / 1024 << " KB";
+
+    for (uint32_t i = 0; i < std::size(lines); ++i)
+    {
+        if (i >= renderStatsOverlayLines.size())
+        {
+            renderStatsOverlayLines.push_back(createText(0, "", { -0.5f, -0.5f - 0.5f * i }, { 0.25f, 0.5f }, { 1, 1, 1, 1 }, UIElement::Position::Right, UIElement::Position::UpperRight));
+        }
+        textInstances.get(renderStatsOverlayLines[i]).text = lines[i].str();
+    }
+}
+
 void TheGame::onWeaponCollision(uint32_t index, uint32_t other, const CollisionRecord& collisionRecord)
 {
     const auto& weapon = weapons.get(index);
@@ -1343,7 +1588,7 @@ void TheGame::onWeaponCollision(uint32_t index, uint32_t other, const CollisionR
         {
             health.value -= hurtbox.multiplier * weapon.damage;
             health.takingDamage = true;
-            audioPlaySound(audio, bonkSound);
+            audioPlaySound(audio, bonkSound, 1.0f);
         }
     }
 }
@@ -1379,7 +1624,7 @@ void TheGame::onTriggerDepotOverlay()
 {
     if (depotOverlays.indices().empty())
     {
-        auto overlay = createOverlay({ 0, 0 }, { 8, 5 }, 0 );
+        auto overlay = createOverlay({ 0, 0 }, { 8, 5 }, {});
         depotOverlays.create(overlay);
         createText(overlay, "Depot", { 0.1f, -0.1f }, { 0.25f, 0.5f }, { 0, 0, 0, 1 }, UIElement::Position::UpperLeft, UIElement::Position::UpperLeft);
 
@@ -1395,7 +1640,7 @@ void TheGame::showStoreOverlay()
 {
     if (storeOverlays.indices().empty())
     {
-        auto overlay = createOverlay({ 0, 0 }, { 8, 5 }, 0 );
+        auto overlay = createOverlay({ 0, 0 }, { 8, 5 }, {});
         storeOverlays.create(overlay);
         createText(overlay, "Store", { 0.1f, -0.1f }, { 0.25f, 0.5f }, { 0, 0, 0, 1 }, UIElement::Position::UpperLeft, UIElement::Position::UpperLeft);
 
@@ -1448,7 +1693,7 @@ void TheGame::showDeliveryOverlay()
 {
     if (deliveryOverlays.indices().empty())
     {
-        auto overlay = createOverlay({ 0, 0 }, { 8, 5 }, 0 );
+        auto overlay = createOverlay({ 0, 0 }, { 8, 5 }, {});
         deliveryOverlays.create(overlay);
         createText(overlay, "Deliveries", { 0.1f, -0.1f }, { 0.25f, 0.5f }, { 0, 0, 0, 1 }, UIElement::Position::UpperLeft, UIElement::Position::UpperLeft);
     }
@@ -1561,7 +1806,7 @@ void TheGame::closeDepotOverlay()
 
 void TheGame::showGameOverOverlay()
 {
-    auto overlay = createOverlay({ 0, 0 }, { 8, 5 }, 0, false);
+    auto overlay = createOverlay({ 0, 0 }, { 8, 5 }, {}, false);
     createText(overlay, "GAME OVER", { 0, -0.1f }, { 0.25f, 0.5f }, { 1, 0, 0, 1 }, UIElement::Position::Top, UIElement::Position::Top);
 
     createText(overlay, "Time:", { -0.1f, -1 }, { 0.25, 0.5 }, { 0, 0, 0, 1 }, UIElement::Position::Right, UIElement::Position::Top);
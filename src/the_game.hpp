@@ -1,10 +1,15 @@
 #pragma once
 
+#include <fstream>
+
 #include "game.hpp"
+#include "audio_assets.hpp"
 #include "ecs.hpp"
 #include "scene_graph.hpp"
 #include "physics_world.hpp"
+#include "gl_render_backend.hpp"
 #include "renderer.hpp"
+#include "texture_atlas.hpp"
 
 using GenericCallback = void (*) (uint32_t, void*);
 using ConditionCallback = bool (*) (uint32_t, void*);
@@ -22,7 +27,7 @@ struct WeaponDescription
     float damage;
     glm::vec2 size;
     glm::vec4 color;
-    GLuint texture;
+    TextureRegion texture;
 };
 
 struct CharacterDescription
@@ -42,8 +47,8 @@ struct CharacterDescription
     glm::vec2 armHurtboxSize;
     float armHurtboxMultiplier;
     float armLength = 0.75f;
-    GLuint characterTexture;
-    GLuint armTexture;
+    TextureRegion characterTexture;
+    TextureRegion armTexture;
     float mass;
     float maxHealth;
 };
@@ -230,11 +235,29 @@ struct StoreOverlay
 
 struct Audio;
 struct Sound;
+struct SoundStream;
+
+// everything draw() reads, copied at the end of update when simulation and rendering are pipelined
+struct RenderSnapshot
+{
+    SceneGraph sceneGraph;
+    DrawInstanceManager drawInstances;
+    ComponentManager<TextInstance> textInstances;
+    ComponentManager<Tilemap> tilemaps;
+    glm::mat4 cameraMatrix;
+    glm::mat4 uiCameraMatrix;
+    int windowWidth;
+    int windowHeight;
+    uint64_t timerValue;
+    double gameTime;
+};
 
 class TheGame final : public Game
 {
     Audio* audio = NULL;
     Sound* bonkSound = NULL;
+    SoundStream* music = NULL;
+    AudioAssets audioAssets { 1 }; // the game only has a few short sounds, so one worker keeps up
     SceneGraph sceneGraph;
     ComponentManager<Arrow> arrows;
     // ComponentManager<Behavior> behaviors;
@@ -246,7 +269,7 @@ class TheGame final : public Game
     ComponentManager<DeliveryOverlay> deliveryOverlays;
     ComponentManager<Depot> depots;
     ComponentManager<DepotOverlay> depotOverlays;
-    ComponentManager<DrawInstance> drawInstances;
+    DrawInstanceManager drawInstances;
     ComponentManager<Dynamic> dynamics;
     ComponentManager<Enemy> enemies;
     ComponentManager<Health> healthComponents;
@@ -258,11 +281,15 @@ class TheGame final : public Game
     ComponentManager<StoreOverlayItem> storeOverlayItems;
     ComponentManager<Temporary> temporaries;
     ComponentManager<TextInstance> textInstances;
+    ComponentManager<Tilemap> tilemaps;
     ComponentManager<Trigger> triggers;
     ComponentManager<UIElement> uiElements;
     ComponentManager<Weapon> weapons;
     EntityManager entityManager;
+    GLRenderBackend renderBackend;
     Renderer renderer;
+    RenderSnapshot renderSnapshot;
+    bool pipelined = false;
     PhysicsWorld physicsWorld;
     std::vector<GLuint> textures;
     CharacterDescription playerBodyDescription;
@@ -284,10 +311,17 @@ class TheGame final : public Game
     uint64_t timerValue;
     uint64_t fpsTimer;
     uint32_t frames;
-    GLuint arrowTexture;
+    float fps = 0;
+    bool logRenderStats = false;
+    uint64_t renderStatsTimer = 0;
+    std::ofstream renderStatsFile;
+    RenderStats lastRenderStats; // only copied while the renderer is idle, so update can read it when pipelined
+    bool showRenderStatsOverlay = false;
+    std::vector<uint32_t> renderStatsOverlayLines;
+    TextureRegion arrowTexture;
     uint32_t hoveredUIElement = 0;
     float enemySpawnTimer = 0;
-    GLuint closeButtonTexture;
+    TextureRegion closeButtonTexture;
     bool mouseButtonDown = false;
     float zombieLevel = 0.1f;
     float zombieLevelRate = 0.01;
@@ -309,16 +343,18 @@ public:
 
     void update(GLFWwindow* window) override;
     void draw() override;
+    void setPipelined(bool pipelined) override;
+    void snapshot() override;
 
     void addHealthComponent(uint32_t index, float maxHealth, GenericCallback onDied = nullptr);
-    uint32_t createSprite(uint32_t parent, const glm::vec2& position, const glm::vec2& size, const glm::vec4& color, GLuint texture, bool flipHorizontal = false, float heightForDepth = 0);
+    uint32_t createSprite(uint32_t parent, const glm::vec2& position, const glm::vec2& size, const glm::vec4& color, const TextureRegion& texture, bool flipHorizontal = false, float heightForDepth = 0, bool isStatic = false, bool isBaked = false);
     uint32_t createHurtbox(uint32_t parent, uint32_t owner, const glm::vec2& position, const glm::vec2& size, float multiplier);
     uint32_t createWeapon(uint32_t owner, const WeaponDescription& description);
     uint32_t createCharacter(const glm::vec2& position, const CharacterDescription& description);
     uint32_t createTrigger(uint32_t parent, const glm::vec2& position, const glm::vec2& size, int key, GenericCallback callback, ConditionCallback condition = nullptr);
     uint32_t createPlayer(const glm::vec2& position);
     uint32_t createZombie(const glm::vec2& position);
-    uint32_t createOverlay(const glm::vec2& position, const glm::vec2& size, GLuint texture, bool closeButton = true);
+    uint32_t createOverlay(const glm::vec2& position, const glm::vec2& size, const TextureRegion& texture, bool closeButton = true);
     uint32_t createText(uint32_t parent, const std::string& text, const glm::vec2& position, const glm::vec2& scale, const glm::vec4& color, UIElement::Position alignment = UIElement::Position::Center, UIElement::Position anchor = UIElement::Position::Center);
     uint32_t createButton(uint32_t overlay, const glm::vec2& size, const glm::vec4& color, float spacing, int index, GenericCallback onClick);
 
@@ -336,6 +372,7 @@ public:
     void updateTemporaries(float dt);
     void updateZombieLevel(float dt);
     void updatePauseOverlay();
+    void updateRenderStatsOverlay();
 
     void setCharacterFlipHorizontal(uint32_t index, bool flipHorizontal);
     void onWeaponCollision(uint32_t index, uint32_t other, const CollisionRecord& collisionRecord);
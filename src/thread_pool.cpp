@@ -0,0 +1,96 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (uint32_t i = 1; i < threadCount; ++i)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    uint64_t seenGeneration = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        workAvailable.wait(lock, [&] { return stopping || generation != seenGeneration; });
+        if (stopping)
+        {
+            return;
+        }
+        seenGeneration = generation;
+        ++activeWorkers;
+
+        lock.unlock();
+        runChunks();
+        lock.lock();
+
+        if (--activeWorkers == 0)
+        {
+            workDone.notify_all();
+        }
+    }
+}
+
+void ThreadPool::runChunks()
+{
+    // a worker that wakes up late finds every chunk taken and never touches the task
+    while (true)
+    {
+        uint32_t begin = nextChunk.fetch_add(1) * taskChunkSize;
+        if (begin >= taskSize)
+        {
+            return;
+        }
+        (*task)(begin, std::min(begin + taskChunkSize, taskSize));
+    }
+}
+
+void ThreadPool::parallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t, uint32_t)>& fn)
+{
+    if (workers.empty() || count <= chunkSize)
+    {
+        if (count > 0)
+        {
+            fn(0, count);
+        }
+        return;
+    }
+
+    {
+        // a worker that woke too late for the previous loop may still be looking at its task
+        std::unique_lock<std::mutex> lock(mutex);
+        workDone.wait(lock, [&] { return activeWorkers == 0; });
+        task = &fn;
+        taskSize = count;
+        taskChunkSize = chunkSize;
+        nextChunk = 0;
+        ++generation;
+    }
+    workAvailable.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [&] { return activeWorkers == 0; });
+}
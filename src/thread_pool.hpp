@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a fixed set of worker threads for splitting loops across cores. the calling thread takes chunks too
+class ThreadPool
+{
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+    const std::function<void(uint32_t, uint32_t)>* task = nullptr;
+    uint32_t taskSize = 0;
+    uint32_t taskChunkSize = 0;
+    std::atomic<uint32_t> nextChunk = 0;
+    uint32_t activeWorkers = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    void workerLoop();
+    void runChunks();
+
+public:
+    // threadCount includes the calling thread. 0 uses every hardware thread
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    uint32_t getThreadCount() const { return workers.size() + 1; }
+
+    // calls fn(begin, end) for chunks covering [0, count) and returns once every chunk is done.
+    // chunks may run concurrently, so fn must only write what its range owns
+    void parallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t, uint32_t)>& fn);
+};
@@ -0,0 +1,116 @@
+#include "tilemap.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "opengl_utils.hpp"
+
+void Tilemap::resize(uint32_t width, uint32_t height)
+{
+    this->width = width;
+    this->height = height;
+    tiles.assign(width * height, 0);
+    ++version;
+}
+
+void Tilemap::stamp(int x, int y, uint32_t blockWidth, uint32_t blockHeight, const std::vector<uint16_t>& block)
+{
+    for (uint32_t row = 0; row < blockHeight; ++row)
+    {
+        int cellY = y + static_cast<int>(blockHeight - 1 - row);
+        if (cellY < 0 || cellY >= static_cast<int>(height))
+        {
+            continue;
+        }
+        for (uint32_t column = 0; column < blockWidth; ++column)
+        {
+            int cellX = x + static_cast<int>(column);
+            if (cellX >= 0 && cellX < static_cast<int>(width))
+            {
+                tiles[cellY * width + cellX] = block[row * blockWidth + column];
+            }
+        }
+    }
+    ++version;
+}
+
+GLuint buildTileset(const std::vector<const Image*>& images, int tileSize, std::vector<std::vector<uint16_t>>& imageTiles,
+    PixelUploadBuffer* staging)
+{
+    // identical tiles share a layer, which is most of a road texture
+    const size_t rowSize = tileSize * 4;
+    std::unordered_map<std::string, uint16_t> tileIds;
+    std::vector<uint8_t> layers;
+    std::string tile(tileSize * rowSize, '\0');
+
+    imageTiles.assign(images.size(), {});
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        const auto& image = *images[i];
+        if (image.width % tileSize != 0 || image.height % tileSize != 0)
+        {
+            throw std::runtime_error("Tileset image size is not a multiple of the tile size");
+        }
+
+        for (int tileY = 0; tileY < image.height; tileY += tileSize)
+        {
+            for (int tileX = 0; tileX < image.width; tileX += tileSize)
+            {
+                bool transparent = true;
+                for (int row = 0; row < tileSize; ++row)
+                {
+                    const uint8_t* source = &image.pixels[4 * ((tileY + row) * image.width + tileX)];
+                    memcpy(&tile[row * rowSize], source, rowSize);
+                    for (size_t alpha = 3; alpha < rowSize && transparent; alpha += 4)
+                    {
+                        transparent = source[alpha] == 0;
+                    }
+                }
+
+                if (transparent)
+                {
+                    imageTiles[i].push_back(0);
+                    continue;
+                }
+
+                auto [it, inserted] = tileIds.emplace(tile, static_cast<uint16_t>(tileIds.size() + 1));
+                if (inserted)
+                {
+                    if (tileIds.size() > UINT16_MAX)
+                    {
+                        throw std::runtime_error("Too many distinct tiles for one tileset");
+                    }
+                    layers.insert(layers.end(), tile.begin(), tile.end());
+                }
+                imageTiles[i].push_back(it->second);
+            }
+        }
+    }
+
+    const void* pixels = layers.empty() ? nullptr : layers.data();
+    if (staging && pixels)
+    {
+        staging->stage(pixels, layers.size());
+        pixels = nullptr;
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, tileSize, tileSize, std::max<GLsizei>(tileIds.size(), 1), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+        pixels);
+    if (staging)
+    {
+        PixelUploadBuffer::unbind();
+    }
+    generateMipmaps(GL_TEXTURE_2D_ARRAY, texture, staging);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    return texture;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+struct Image;
+class PixelUploadBuffer;
+
+// a grid of tiles drawn as one quad. the fragment shader looks up each pixel's tile in a map texture,
+// so the cost per frame doesn't depend on the size of the map
+struct Tilemap
+{
+    glm::vec2 origin = glm::vec2(0.0f); // world position of the lower left corner of cell (0, 0)
+    float tileSize = 1.0f;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint16_t> tiles; // row-major starting from the bottom row. 0 is empty, otherwise tileset layer + 1
+    GLuint tileset = 0; // GL_TEXTURE_2D_ARRAY with one tile per layer, see buildTileset
+    glm::vec4 color = glm::vec4(1.0f);
+    uint32_t layer = 0;
+    uint32_t version = 0; // bump after editing tiles so the renderer uploads them again
+
+    void resize(uint32_t width, uint32_t height);
+
+    // copies a block of tiles, top row first, so that its lower left tile lands on cell (x, y). tiles outside the map are dropped
+    void stamp(int x, int y, uint32_t blockWidth, uint32_t blockHeight, const std::vector<uint16_t>& block);
+};
+
+// cuts each image into tileSize squares and uploads the distinct ones as layers of a GL_TEXTURE_2D_ARRAY.
+// imageTiles[i] receives images[i]'s tiles as tilemap values, top row first. fully transparent tiles become 0.
+// staging is optional, see PixelUploadBuffer
+GLuint buildTileset(const std::vector<const Image*>& images, int tileSize, std::vector<std::vector<uint16_t>>& imageTiles,
+    PixelUploadBuffer* staging = nullptr);
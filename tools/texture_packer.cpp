@@ -0,0 +1,123 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "image_loader.hpp"
+#include "texture_pack.hpp"
+
+// usage: texture_packer <output> <image>...
+// decodes each image and writes it with its mip chain to a texture pack, see texture_pack.hpp
+
+// each texel of the next level averages the 2x2 block above it. odd edges reuse their last row or column
+static std::vector<uint8_t> downsample(const uint8_t* pixels, int width, int height)
+{
+    int nextWidth = std::max(width / 2, 1);
+    int nextHeight = std::max(height / 2, 1);
+    std::vector<uint8_t> result(4 * nextWidth * nextHeight);
+    for (int y = 0; y < nextHeight; ++y)
+    {
+        int y0 = std::min(2 * y, height - 1);
+        int y1 = std::min(2 * y + 1, height - 1);
+        for (int x = 0; x < nextWidth; ++x)
+        {
+            int x0 = std::min(2 * x, width - 1);
+            int x1 = std::min(2 * x + 1, width - 1);
+            for (int c = 0; c < 4; ++c)
+            {
+                int sum = pixels[4 * (y0 * width + x0) + c] + pixels[4 * (y0 * width + x1) + c]
+                    + pixels[4 * (y1 * width + x0) + c] + pixels[4 * (y1 * width + x1) + c];
+                result[4 * (y * nextWidth + x) + c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+static std::string getBaseName(const std::string& filename)
+{
+    auto separator = filename.find_last_of("/\\");
+    return separator == std::string::npos ? filename : filename.substr(separator + 1);
+}
+
+static void writePack(const char* outputFilename, const std::vector<std::string>& inputFilenames)
+{
+    std::vector<TexturePackEntry> entries(inputFilenames.size());
+    std::vector<std::vector<uint8_t>> levelData(inputFilenames.size());
+    uint64_t offset = sizeof(TexturePackHeader) + entries.size() * sizeof(TexturePackEntry);
+    for (size_t i = 0; i < inputFilenames.size(); ++i)
+    {
+        std::string name = getBaseName(inputFilenames[i]);
+        if (name.size() >= TEXTURE_PACK_NAME_SIZE)
+        {
+            throw std::runtime_error("Image name too long for texture pack: " + name);
+        }
+        Image image = loadImage(inputFilenames[i].c_str());
+
+        auto& entry = entries[i];
+        std::memset(&entry, 0, sizeof(entry));
+        std::memcpy(entry.name, name.c_str(), name.size());
+        entry.width = image.width;
+        entry.height = image.height;
+        entry.offset = offset;
+
+        auto& data = levelData[i];
+        data = image.pixels;
+        std::vector<uint8_t> level = std::move(image.pixels);
+        int width = image.width;
+        int height = image.height;
+        entry.levelCount = 1;
+        while (width > 1 || height > 1)
+        {
+            level = downsample(level.data(), width, height);
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+            data.insert(data.end(), level.begin(), level.end());
+            ++entry.levelCount;
+        }
+        entry.size = data.size();
+        offset += data.size();
+    }
+
+    std::ofstream output(outputFilename, std::ios::binary);
+    if (!output)
+    {
+        throw std::runtime_error("Failed to open file: " + std::string(outputFilename));
+    }
+    TexturePackHeader header = {};
+    std::memcpy(header.magic, TEXTURE_PACK_MAGIC, sizeof(header.magic));
+    header.version = TEXTURE_PACK_VERSION;
+    header.entryCount = entries.size();
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(TexturePackEntry));
+    for (const auto& data : levelData)
+    {
+        output.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+    if (!output)
+    {
+        throw std::runtime_error("Failed to write file: " + std::string(outputFilename));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <output> <image>..." << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        writePack(argv[1], std::vector<std::string>(argv + 2, argv + argc));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}